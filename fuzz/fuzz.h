@@ -0,0 +1,30 @@
+#ifndef SMARTLAMP_FUZZ_H
+#define SMARTLAMP_FUZZ_H
+
+// Utilidades comuns aos alvos de fuzzing dos parsers (ver Makefile).
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Falha do alvo: aborta para o libFuzzer (ou o replay) guardar a entrada
+#define VERIFICA(cond)                                                         \
+    do {                                                                       \
+        if (!(cond))                                                           \
+            abort();                                                           \
+    } while (0)
+
+// Copia a entrada para um bloco do tamanho exato, terminado em '\0', para o
+// ASan pegar qualquer leitura além do fim da linha
+static inline char *copiar_linha(const uint8_t *data, size_t size)
+{
+    char *line = (char *)malloc(size + 1);
+
+    VERIFICA(line != NULL);
+    memcpy(line, data, size);
+    line[size] = '\0';
+    return line;
+}
+
+#endif
@@ -0,0 +1,29 @@
+// Alvo de fuzzing do separar_carimbo: quando acha o " @<amostra>,<resposta>"
+// no fim da linha, corta a linha exatamente antes dele e os dois valores
+// cabem em 32 bits. O que sobra passa pelo parser de números, como no driver.
+
+#include "smartlamp_parse.h"
+
+#include "fuzz.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    char *line = copiar_linha(data, size);
+    size_t antes = strlen(line);
+    unsigned long amostra, resposta;
+    long valor;
+
+    if (separar_carimbo(line, &amostra, &resposta) == 0) {
+        size_t depois = strlen(line);
+
+        VERIFICA(depois + 3 < antes);
+        VERIFICA((char)data[depois] == ' ' && (char)data[depois + 1] == '@');
+        VERIFICA(amostra <= 0xffffffffUL && resposta <= 0xffffffffUL);
+    } else {
+        VERIFICA(strlen(line) == antes);
+    }
+    extrair_ultimo_numero_kernel(line, &valor);
+
+    free(line);
+    return 0;
+}
@@ -0,0 +1,30 @@
+// Alvo de fuzzing do parser do GET_DHT / EVT DHT. O primeiro byte escolhe o
+// formato (bit 0: inteiros do SET_FORMAT 1, senão texto decimal); o resto é
+// a linha, já sem o carimbo.
+
+#include "smartlamp_parse.h"
+
+#include "fuzz.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    char *line;
+    int inteiros;
+    long valores[4];
+
+    if (size == 0)
+        return 0;
+    inteiros = data[0] & 1;
+    line = copiar_linha(data + 1, size - 1);
+
+    if (extrair_dht_kernel(line, inteiros, valores) == 0 && inteiros) {
+        // Escalas fixas: centésimos, décimos, centésimos e um inteiro
+        VERIFICA(valores[0] % 10 == 0);
+        VERIFICA(valores[1] % 100 == 0);
+        VERIFICA(valores[2] % 10 == 0);
+        VERIFICA(valores[3] % 1000 == 0);
+    }
+
+    free(line);
+    return 0;
+}
@@ -0,0 +1,71 @@
+// Alvo de fuzzing do parser de comandos do firmware: separa a linha como o
+// processCommand, procura o nome numa tabela de comandos e valida o
+// argumento. A linha vai num bloco sem terminador, como a que sai do
+// LineBuffer.
+
+#include "protocol.h"
+
+#include "fuzz.h"
+
+static void nada(long) {}
+static void nadaPalavra(const char *, const long *, uint8_t) {}
+
+// Os comandos do firmware (commandSpecs no smartlamp.ino), para a busca usar
+// a mesma tabela de hash
+static constexpr ProtocolCommandSpec specs[] = {
+    {"SET_LED", PROTOCOL_ARG_INT, 0, 100, nada, nullptr},
+    {"GET_LED", PROTOCOL_ARG_NONE, 0, 0, nada, nullptr},
+    {"GET_LDR", PROTOCOL_ARG_NONE, 0, 0, nada, nullptr},
+    {"SET_LDR_FILTER", PROTOCOL_ARG_INT, 0, 8, nada, nullptr},
+    {"LDR_CAPTURE", PROTOCOL_ARG_INT, 1, 512, nada, nullptr},
+    {"LDR_DUMP", PROTOCOL_ARG_NONE, 0, 0, nada, nullptr},
+    {"GET_TEMP", PROTOCOL_ARG_NONE, 0, 0, nada, nullptr},
+    {"GET_HUM", PROTOCOL_ARG_NONE, 0, 0, nada, nullptr},
+    {"GET_DHT", PROTOCOL_ARG_NONE, 0, 0, nada, nullptr},
+    {"GET_ZONE", PROTOCOL_ARG_INT, 0, 0, nada, nullptr},
+    {"SET_STAMP", PROTOCOL_ARG_INT, 0, 1, nada, nullptr},
+    {"SET_FORMAT", PROTOCOL_ARG_INT, 0, 1, nada, nullptr},
+    {"GET_STATS", PROTOCOL_ARG_NONE, 0, 0, nada, nullptr},
+    {"GET_HISTORY", PROTOCOL_ARG_INT, 0, 2000000, nada, nullptr},
+    {"SUBSCRIBE", PROTOCOL_ARG_WORD_INT, 0, 3600000, nullptr, nadaPalavra},
+    {"SET_REPORT", PROTOCOL_ARG_WORD_INT, 0, 10000, nullptr, nadaPalavra},
+    {"UNSUBSCRIBE", PROTOCOL_ARG_NONE, 0, 0, nada, nullptr},
+};
+static constexpr ProtocolTable<sizeof(specs) / sizeof(specs[0])> table(specs);
+static_assert(table.perfect(), "nome de comando repetido em specs");
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  char *line = (char *)malloc(size ? size : 1);
+  VERIFICA(line != NULL);
+  memcpy(line, data, size);
+
+  ProtocolCommand cmd;
+  if (protocolParse(line, size, &cmd)) {
+    size_t nameLen = strlen(cmd.name);
+    VERIFICA(nameLen <= PROTOCOL_MAX_NAME);
+    VERIFICA(strlen(cmd.word) <= PROTOCOL_MAX_NAME);
+    VERIFICA(cmd.valueCount <= PROTOCOL_MAX_VALUES);
+    VERIFICA(cmd.hasValue || cmd.value == 0);
+    VERIFICA(cmd.valueValid || cmd.value == 0);
+
+    const ProtocolCommandSpec *spec = table.find(cmd.name, nameLen);
+    VERIFICA(!spec || strcmp(spec->name, cmd.name) == 0);
+    if (spec && protocolCheckArg(*spec, cmd)) {
+      long value = spec->arg == PROTOCOL_ARG_WORD_INT ? cmd.values[0] : cmd.value;
+      VERIFICA(spec->arg == PROTOCOL_ARG_NONE || (value >= spec->min && value <= spec->max));
+      // Um argumento inteiro precisa começar com dígitos, com sinal opcional
+      // (depois dos espaços que o parseLong pula)
+      if (spec->arg == PROTOCOL_ARG_INT) {
+        size_t i = 0;
+        while (i < size && line[i] && strchr(" \t\r\n\v\f", line[i])) i++;
+        i += nameLen;
+        while (i < size && line[i] && strchr(" \t\r\n\v\f", line[i])) i++;
+        if (i < size && (line[i] == '+' || line[i] == '-')) i++;
+        VERIFICA(i < size && line[i] >= '0' && line[i] <= '9');
+      }
+    }
+  }
+
+  free(line);
+  return 0;
+}
@@ -0,0 +1,52 @@
+// Alvo de fuzzing do parser de respostas do driver: acha a primeira linha
+// RES/ERR depois do eco do comando e extrai o último número em milésimos,
+// como o usb_send_cmd_locked faz com a resposta. Um valor extraído precisa
+// voltar igual depois de formatado pelo formatar_milesimos e lido de novo.
+// A linha também passa pelo resposta_do_comando sem o '\0' no fim, como o
+// usb_rx_linha a entrega, para o ASan pegar leitura além do fim.
+
+#include "smartlamp_parse.h"
+
+#include "fuzz.h"
+
+static const char *const comandos[] = {
+    "GET_LDR", "GET_LED", "SET_LED", "GET_TEMP", "GET_HUM", "GET_DHT",
+    "SUBSCRIBE LDR", "SET_STAMP", "SET_FORMAT",
+};
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    char *line = copiar_linha(data, size);
+    const char *texto = line;
+    size_t ini, fim;
+    long valor, de_volta;
+
+    if (encontrar_linha_resposta(line, size, &ini, &fim) == 0) {
+        VERIFICA(ini <= fim && fim < size);
+        VERIFICA(linha_eh_resposta(line + ini, fim - ini));
+        if (fim - ini > 0) {
+            char *crua = malloc(fim - ini);
+            size_t i;
+
+            memcpy(crua, line + ini, fim - ini);
+            for (i = 0; i < sizeof(comandos) / sizeof(comandos[0]); i++)
+                resposta_do_comando(crua, fim - ini, comandos[i]);
+            free(crua);
+        }
+        line[fim] = '\0';
+        texto = line + ini;
+    }
+
+    if (extrair_ultimo_numero_kernel(texto, &valor) == 0) {
+        char buf[MAX_NUM_STR_SIZE];
+        int n = formatar_milesimos(buf, sizeof(buf), valor);
+
+        VERIFICA(n > 1 && (size_t)n < sizeof(buf) && buf[n - 1] == '\n');
+        buf[n - 1] = '\0';
+        VERIFICA(extrair_ultimo_numero_kernel(buf, &de_volta) == 0);
+        VERIFICA(de_volta == valor);
+    }
+
+    free(line);
+    return 0;
+}
@@ -0,0 +1,185 @@
+// Alvo de fuzzing do histórico em arquivo colunar (libsmartlamp/series.h).
+// O primeiro byte escolhe o modo:
+//   - par: o resto vira amostras de duas lâmpadas, gravadas pelo SeriesWriter
+//     e lidas de volta pelo SeriesReader. query, a query com filtro de coluna
+//     e summarize precisam devolver exatamente o que foi gravado, e o .lamps
+//     precisa dar o mesmo número a cada nome;
+//   - ímpar: o resto é o próprio arquivo (sem o cabeçalho, que é sempre
+//     válido), lido como viria de um disco corrompido. Só não pode quebrar.
+
+#include "series.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "fuzz.h"
+
+using smartlamp::Column;
+using smartlamp::Sample;
+using smartlamp::SeriesReader;
+using smartlamp::SeriesWriter;
+using smartlamp::Summary;
+
+static const char *const nomes[] = {"smartlamp", "serial0-0"};
+
+// Bytes de uma amostra: lâmpada e flush, avanço do tempo (2), ldr, led,
+// temp (4) e hum (4)
+static const size_t kBytesAmostra = 13;
+
+static int32_t ler_i32(const uint8_t *p) {
+  return (int32_t)((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+                   (uint32_t)p[3] << 24);
+}
+
+static bool iguais(const Sample &a, const Sample &b) {
+  return a.time_ms == b.time_ms && a.ldr == b.ldr && a.led == b.led &&
+         a.temp_centi == b.temp_centi && a.hum_centi == b.hum_centi;
+}
+
+static bool iguais(const std::vector<Sample> &a, const std::vector<Sample> &b) {
+  if (a.size() != b.size())
+    return false;
+  for (size_t i = 0; i < a.size(); i++)
+    if (!iguais(a[i], b[i]))
+      return false;
+  return true;
+}
+
+static int32_t coluna(const Sample &s, Column c) {
+  switch (c) {
+  case Column::Ldr:
+    return s.ldr;
+  case Column::Led:
+    return s.led;
+  case Column::Temp:
+    return s.temp_centi;
+  default:
+    return s.hum_centi;
+  }
+}
+
+// Confere uma consulta [from, to] contra as amostras gravadas da lâmpada
+static void conferir(const SeriesReader &reader, uint16_t id,
+                     const std::vector<Sample> &gravadas, int64_t from, int64_t to) {
+  std::vector<Sample> esperadas;
+  Summary esperado;
+
+  for (const Sample &s : gravadas) {
+    if (s.time_ms < from || s.time_ms > to)
+      continue;
+    esperadas.push_back(s);
+    int32_t v[4] = {s.ldr, s.led, s.temp_centi, s.hum_centi};
+    for (size_t c = 0; c < 4; c++) {
+      esperado.min[c] = esperado.count ? std::min(esperado.min[c], v[c]) : v[c];
+      esperado.max[c] = esperado.count ? std::max(esperado.max[c], v[c]) : v[c];
+    }
+    esperado.count++;
+  }
+  VERIFICA(iguais(reader.query(id, from, to), esperadas));
+
+  Summary sum = reader.summarize(id, from, to);
+  VERIFICA(sum.count == esperado.count);
+  for (size_t c = 0; c < 4 && sum.count; c++)
+    VERIFICA(sum.min[c] == esperado.min[c] && sum.max[c] == esperado.max[c]);
+
+  // Filtro pela metade de cima de cada coluna, para pular blocos pelo
+  // mínimo/máximo do cabeçalho
+  for (size_t c = 0; c < 4 && sum.count; c++) {
+    Column col = static_cast<Column>(c);
+    int32_t lo = esperado.min[c] + (int32_t)(((int64_t)esperado.max[c] - esperado.min[c]) / 2);
+    std::vector<Sample> filtradas;
+    for (const Sample &s : esperadas)
+      if (coluna(s, col) >= lo)
+        filtradas.push_back(s);
+    VERIFICA(iguais(reader.query(id, from, to, col, lo, esperado.max[c]), filtradas));
+  }
+}
+
+static void ida_e_volta(const std::string &path, const uint8_t *data, size_t size) {
+  std::vector<Sample> gravadas[2];
+  uint16_t ids[2];
+  int64_t time = 1700000000000;
+
+  {
+    SeriesWriter writer;
+    VERIFICA(writer.open(path) == 0);
+    for (size_t i = 0; i < 2; i++)
+      VERIFICA(writer.lamp_id(nomes[i], &ids[i]) == 0);
+    VERIFICA(ids[0] != ids[1]);
+
+    for (; size >= kBytesAmostra; data += kBytesAmostra, size -= kBytesAmostra) {
+      size_t lamp = data[0] & 1;
+      Sample s;
+
+      time += data[1] | data[2] << 8;
+      s.time_ms = time;
+      s.ldr = data[3];
+      s.led = (int8_t)data[4];
+      s.temp_centi = ler_i32(data + 5);
+      s.hum_centi = ler_i32(data + 9);
+      VERIFICA(writer.append(ids[lamp], s) == 0);
+      gravadas[lamp].push_back(s);
+      // Blocos pequenos, para a consulta cruzar vários
+      if (data[0] & 2)
+        VERIFICA(writer.flush() == 0);
+    }
+    VERIFICA(writer.close() == 0);
+  }
+
+  SeriesReader reader;
+  VERIFICA(reader.open(path) == 0);
+  for (size_t i = 0; i < 2; i++) {
+    uint16_t id;
+    VERIFICA(reader.lamp_id(nomes[i], &id) && id == ids[i]);
+
+    const std::vector<Sample> &g = gravadas[i];
+    conferir(reader, id, g, INT64_MIN, INT64_MAX);
+    if (!g.empty())
+      conferir(reader, id, g, g[g.size() / 3].time_ms, g[2 * g.size() / 3].time_ms);
+  }
+  uint16_t id;
+  VERIFICA(!reader.lamp_id("outra", &id));
+
+  // Um segundo writer no mesmo arquivo mantém os números
+  SeriesWriter writer;
+  VERIFICA(writer.open(path) == 0);
+  VERIFICA(writer.lamp_id(nomes[1], &id) == 0 && id == ids[1]);
+}
+
+static void arquivo_corrompido(const std::string &path, const uint8_t *data, size_t size) {
+  static const uint8_t cabecalho[16] = {'S', 'L', 'S', 'E', 'R', 'I', 'E', 'S', 1};
+  FILE *f = fopen(path.c_str(), "wb");
+
+  VERIFICA(f != NULL);
+  VERIFICA(fwrite(cabecalho, 1, sizeof(cabecalho), f) == sizeof(cabecalho));
+  VERIFICA(fwrite(data, 1, size, f) == size);
+  fclose(f);
+
+  SeriesReader reader;
+  VERIFICA(reader.open(path) == 0);
+  for (uint16_t lamp = 0; lamp < 4; lamp++) {
+    reader.query(lamp, INT64_MIN, INT64_MAX);
+    reader.query(lamp, INT64_MIN, INT64_MAX, Column::Temp, 0, INT32_MAX);
+    reader.summarize(lamp, 0, INT64_MAX);
+  }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  static const std::string path = "/tmp/fuzz_series-" + std::to_string(getpid());
+
+  if (size == 0)
+    return 0;
+  unlink(path.c_str());
+  unlink((path + ".lamps").c_str());
+  if (data[0] & 1)
+    arquivo_corrompido(path, data + 1, size - 1);
+  else
+    ida_e_volta(path, data + 1, size - 1);
+  unlink(path.c_str());
+  unlink((path + ".lamps").c_str());
+  return 0;
+}
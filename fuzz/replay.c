@@ -0,0 +1,124 @@
+// Roda um alvo de fuzzing sobre arquivos do corpus sem o libFuzzer (para
+// compiladores sem -fsanitize=fuzzer) e mede o custo de cada entrada.
+//
+//   ./replay_resposta corpus/resposta            # todos os arquivos
+//   ./replay_resposta -n 1000 corpus/resposta    # média de 1000 execuções
+//
+// Imprime "<ns> <arquivo>" por entrada e no fim o total, a média e a mais
+// cara, para comparar versões do parser.
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static unsigned long repeticoes = 1;
+static unsigned long entradas;
+static double total_ns, max_ns;
+static char max_arquivo[4096];
+
+static double agora_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int rodar_arquivo(const char *caminho)
+{
+    FILE *f = fopen(caminho, "rb");
+    uint8_t *data;
+    long size;
+    double ini, ns;
+    unsigned long i;
+
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", caminho, strerror(errno));
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    rewind(f);
+    data = malloc(size ? size : 1);
+    if (!data || fread(data, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "%s: leitura falhou\n", caminho);
+        fclose(f);
+        free(data);
+        return -1;
+    }
+    fclose(f);
+
+    ini = agora_ns();
+    for (i = 0; i < repeticoes; i++)
+        LLVMFuzzerTestOneInput(data, size);
+    ns = (agora_ns() - ini) / repeticoes;
+    free(data);
+
+    printf("%10.0f %s\n", ns, caminho);
+    entradas++;
+    total_ns += ns;
+    if (ns > max_ns) {
+        max_ns = ns;
+        snprintf(max_arquivo, sizeof(max_arquivo), "%s", caminho);
+    }
+    return 0;
+}
+
+static int rodar(const char *caminho)
+{
+    struct stat st;
+    struct dirent **nomes;
+    int n, i, ret = 0;
+
+    if (stat(caminho, &st) != 0) {
+        fprintf(stderr, "%s: %s\n", caminho, strerror(errno));
+        return -1;
+    }
+    if (!S_ISDIR(st.st_mode))
+        return rodar_arquivo(caminho);
+
+    n = scandir(caminho, &nomes, NULL, alphasort);
+    if (n < 0)
+        return -1;
+    for (i = 0; i < n; i++) {
+        char sub[4096];
+
+        if (nomes[i]->d_name[0] != '.') {
+            snprintf(sub, sizeof(sub), "%s/%s", caminho, nomes[i]->d_name);
+            ret |= rodar(sub);
+        }
+        free(nomes[i]);
+    }
+    free(nomes);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int i = 1, ret = 0;
+
+    if (i + 1 < argc && strcmp(argv[i], "-n") == 0) {
+        repeticoes = strtoul(argv[i + 1], NULL, 10);
+        if (repeticoes == 0)
+            repeticoes = 1;
+        i += 2;
+    }
+    if (i == argc) {
+        fprintf(stderr, "uso: %s [-n repetições] <arquivo|diretório>...\n", argv[0]);
+        return 2;
+    }
+    for (; i < argc; i++)
+        ret |= rodar(argv[i]);
+
+    if (entradas)
+        printf("%lu entradas, total %.0f ns, média %.0f ns, máx %.0f ns (%s)\n",
+               entradas, total_ns, total_ns / entradas, max_ns, max_arquivo);
+    return ret ? 1 : 0;
+}
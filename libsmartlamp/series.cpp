@@ -0,0 +1,575 @@
+#include "series.h"
+
+#include <algorithm>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace smartlamp {
+
+namespace {
+
+// Formato em disco (little-endian, como os hosts que usamos)
+const char kFileMagic[8] = {'S', 'L', 'S', 'E', 'R', 'I', 'E', 'S'};
+const uint32_t kFileVersion = 1;
+const uint32_t kBlockMagic = 0x4b424c53; // "SLBK"
+const size_t kNumColumns = 5;            // tempo, ldr, led, temp, hum
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+};
+
+struct DiskBlock {
+  uint32_t magic;
+  uint16_t lamp;
+  uint16_t count;
+  int64_t t_min;
+  int64_t t_max;
+  int32_t min[4];
+  int32_t max[4];
+  uint32_t col_size[kNumColumns];
+  uint32_t reserved;
+};
+
+static_assert(sizeof(FileHeader) == 16, "layout do cabeçalho do arquivo");
+static_assert(sizeof(DiskBlock) == 80, "layout do cabeçalho do bloco");
+
+uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+
+int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+void put_varint(std::vector<uint8_t> *out, uint64_t v) {
+  while (v >= 0x80) {
+    out->push_back((uint8_t)(v | 0x80));
+    v >>= 7;
+  }
+  out->push_back((uint8_t)v);
+}
+
+// Lê um varint de [*p, end); retorna false se a coluna acabar no meio dele
+bool get_varint(const uint8_t **p, const uint8_t *end, uint64_t *v) {
+  uint64_t result = 0;
+  for (int shift = 0; *p < end && shift < 64; shift += 7) {
+    uint8_t byte = *(*p)++;
+    result |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      *v = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Cada coluna é uma sequência de diferenças. Diferenças nulas seguidas (o
+// caso comum: taxa constante, sensor parado) viram uma única ficha:
+//   ficha = zigzag(d) << 1      para uma diferença d != 0
+//   ficha = (n << 1) | 1        para n diferenças nulas seguidas
+class ColumnEncoder {
+public:
+  explicit ColumnEncoder(std::vector<uint8_t> *out) : out_(out) {}
+  ~ColumnEncoder() { finish(); }
+
+  void put(int64_t d) {
+    if (d == 0) {
+      zeros_++;
+      return;
+    }
+    finish();
+    put_varint(out_, zigzag(d) << 1);
+  }
+
+  void finish() {
+    if (zeros_) {
+      put_varint(out_, (zeros_ << 1) | 1);
+      zeros_ = 0;
+    }
+  }
+
+private:
+  std::vector<uint8_t> *out_;
+  uint64_t zeros_ = 0;
+};
+
+class ColumnDecoder {
+public:
+  ColumnDecoder() = default;
+  ColumnDecoder(const uint8_t *p, const uint8_t *end) : p_(p), end_(end) {}
+
+  // Próxima diferença; false se a coluna acabar antes da hora
+  bool get(int64_t *d) {
+    if (zeros_ == 0) {
+      uint64_t token;
+      if (!get_varint(&p_, end_, &token))
+        return false;
+      if (!(token & 1)) {
+        *d = unzigzag(token >> 1);
+        return true;
+      }
+      zeros_ = token >> 1;
+      if (zeros_ == 0)
+        return false;
+    }
+    zeros_--;
+    *d = 0;
+    return true;
+  }
+
+private:
+  const uint8_t *p_ = nullptr, *end_ = nullptr;
+  uint64_t zeros_ = 0;
+};
+
+int32_t column_value(const Sample &s, size_t col) {
+  switch (col) {
+  case 0:
+    return s.ldr;
+  case 1:
+    return s.led;
+  case 2:
+    return s.temp_centi;
+  default:
+    return s.hum_centi;
+  }
+}
+
+int32_t *column_ptr(Sample *s, size_t col) {
+  switch (col) {
+  case 0:
+    return &s->ldr;
+  case 1:
+    return &s->led;
+  case 2:
+    return &s->temp_centi;
+  default:
+    return &s->hum_centi;
+  }
+}
+
+int write_all(int fd, const void *buf, size_t len) {
+  const uint8_t *p = static_cast<const uint8_t *>(buf);
+  while (len > 0) {
+    ssize_t n = write(fd, p, len);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return errno;
+    }
+    p += n;
+    len -= n;
+  }
+  return 0;
+}
+
+// Tamanho da parte válida do arquivo: cabeçalho mais os blocos completos.
+// Um bloco cortado por uma queda no meio da escrita fica de fora.
+off_t valid_length(int fd, off_t size) {
+  off_t pos = sizeof(FileHeader);
+  DiskBlock hdr;
+
+  while (pos + (off_t)sizeof(hdr) <= size) {
+    if (pread(fd, &hdr, sizeof(hdr), pos) != sizeof(hdr) || hdr.magic != kBlockMagic)
+      break;
+    off_t total = sizeof(hdr);
+    for (size_t c = 0; c < kNumColumns; c++)
+      total += hdr.col_size[c];
+    if (pos + total > size)
+      break;
+    pos += total;
+  }
+  return pos;
+}
+
+std::string names_path(const std::string &path) { return path + ".lamps"; }
+
+// Lê o .lamps ("<número> <nome>" por linha). Um arquivo que não existe é um
+// mapa vazio; linhas que não seguem o formato são puladas.
+int load_names(const std::string &path, std::map<std::string, uint16_t> *ids) {
+  ids->clear();
+  FILE *f = fopen(path.c_str(), "re");
+  if (!f)
+    return errno == ENOENT ? 0 : errno;
+
+  char line[512];
+  while (fgets(line, sizeof(line), f)) {
+    char *end;
+    unsigned long id = strtoul(line, &end, 10);
+    if (end == line || *end != ' ' || id > UINT16_MAX)
+      continue;
+    std::string name(end + 1);
+    if (!name.empty() && name.back() == '\n')
+      name.pop_back();
+    if (!name.empty())
+      (*ids)[name] = id;
+  }
+  fclose(f);
+  return 0;
+}
+
+} // namespace
+
+SeriesWriter::~SeriesWriter() { close(); }
+
+int SeriesWriter::open(const std::string &path) {
+  struct stat st;
+  int ret = 0;
+
+  close();
+  fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (fd_ < 0)
+    return errno;
+  if (fstat(fd_, &st) < 0) {
+    ret = errno;
+  } else if (st.st_size == 0) {
+    FileHeader hdr;
+    memcpy(hdr.magic, kFileMagic, sizeof(hdr.magic));
+    hdr.version = kFileVersion;
+    hdr.reserved = 0;
+    ret = write_all(fd_, &hdr, sizeof(hdr));
+  } else {
+    FileHeader hdr;
+    if (pread(fd_, &hdr, sizeof(hdr), 0) != sizeof(hdr) ||
+        memcmp(hdr.magic, kFileMagic, sizeof(hdr.magic)) != 0 || hdr.version != kFileVersion) {
+      ret = EINVAL;
+    } else {
+      // Descarta um bloco incompleto no fim antes de continuar anexando
+      off_t valid = valid_length(fd_, st.st_size);
+      if (valid != st.st_size && ftruncate(fd_, valid) < 0)
+        ret = errno;
+    }
+  }
+  if (!ret) {
+    names_path_ = names_path(path);
+    ret = load_names(names_path_, &ids_);
+  }
+
+  if (ret) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  return ret;
+}
+
+int SeriesWriter::lamp_id(const std::string &name, uint16_t *id) {
+  if (fd_ < 0)
+    return EBADF;
+  if (name.empty() || name.find_first_of("\n") != std::string::npos)
+    return EINVAL;
+
+  auto it = ids_.find(name);
+  if (it != ids_.end()) {
+    *id = it->second;
+    return 0;
+  }
+
+  uint32_t next = 0;
+  for (const auto &entry : ids_)
+    next = std::max<uint32_t>(next, entry.second + 1);
+  if (next > UINT16_MAX)
+    return ENOSPC;
+
+  // O nome vai para o disco antes de qualquer bloco com o número novo
+  int fd = ::open(names_path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return errno;
+  std::string line = std::to_string(next) + " " + name + "\n";
+  int ret = write_all(fd, line.data(), line.size());
+  ::close(fd);
+  if (ret)
+    return ret;
+
+  ids_[name] = next;
+  *id = next;
+  return 0;
+}
+
+int SeriesWriter::append(uint16_t lamp, const Sample &sample) {
+  if (fd_ < 0)
+    return EBADF;
+
+  std::vector<Sample> &block = pending_[lamp];
+  if (!block.empty() && sample.time_ms < block.back().time_ms)
+    return EINVAL;
+
+  block.push_back(sample);
+  if (block.size() < kBlockSamples)
+    return 0;
+
+  int ret = write_block(lamp, block);
+  block.clear();
+  return ret;
+}
+
+int SeriesWriter::flush() {
+  int ret = 0;
+
+  if (fd_ < 0)
+    return EBADF;
+  for (auto &entry : pending_) {
+    if (entry.second.empty())
+      continue;
+    int r = write_block(entry.first, entry.second);
+    if (r && !ret)
+      ret = r;
+    entry.second.clear();
+  }
+  return ret;
+}
+
+int SeriesWriter::close() {
+  int ret = 0;
+
+  if (fd_ >= 0) {
+    ret = flush();
+    ::close(fd_);
+    fd_ = -1;
+  }
+  pending_.clear();
+  ids_.clear();
+  return ret;
+}
+
+int SeriesWriter::write_block(uint16_t lamp, const std::vector<Sample> &samples) {
+  std::vector<uint8_t> cols[kNumColumns];
+  DiskBlock hdr;
+
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = kBlockMagic;
+  hdr.lamp = lamp;
+  hdr.count = samples.size();
+  hdr.t_min = samples.front().time_ms;
+  hdr.t_max = samples.back().time_ms;
+  for (size_t c = 0; c < 4; c++)
+    hdr.min[c] = hdr.max[c] = column_value(samples.front(), c);
+
+  // Tempo: o primeiro está em t_min; depois, delta do delta
+  {
+    ColumnEncoder enc(&cols[0]);
+    int64_t prev_delta = 0;
+    for (size_t i = 1; i < samples.size(); i++) {
+      int64_t delta = samples[i].time_ms - samples[i - 1].time_ms;
+      enc.put(delta - prev_delta);
+      prev_delta = delta;
+    }
+  }
+
+  // Valores: o primeiro inteiro, depois a diferença para o anterior
+  for (size_t c = 0; c < 4; c++) {
+    ColumnEncoder enc(&cols[c + 1]);
+    int32_t prev = 0;
+    for (const Sample &s : samples) {
+      int32_t v = column_value(s, c);
+      enc.put((int64_t)v - prev);
+      prev = v;
+      hdr.min[c] = std::min(hdr.min[c], v);
+      hdr.max[c] = std::max(hdr.max[c], v);
+    }
+  }
+
+  std::vector<uint8_t> buf(sizeof(hdr));
+  for (size_t c = 0; c < kNumColumns; c++) {
+    hdr.col_size[c] = cols[c].size();
+    buf.insert(buf.end(), cols[c].begin(), cols[c].end());
+  }
+  memcpy(buf.data(), &hdr, sizeof(hdr));
+
+  return write_all(fd_, buf.data(), buf.size());
+}
+
+SeriesReader::~SeriesReader() { close(); }
+
+int SeriesReader::open(const std::string &path) {
+  struct stat st;
+  FileHeader fh;
+
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return errno;
+  if (fstat(fd, &st) < 0) {
+    int ret = errno;
+    ::close(fd);
+    return ret;
+  }
+  if ((size_t)st.st_size < sizeof(fh)) {
+    ::close(fd);
+    return EINVAL;
+  }
+
+  void *mem = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mem == MAP_FAILED)
+    return errno;
+  data_ = static_cast<const uint8_t *>(mem);
+  size_ = st.st_size;
+
+  memcpy(&fh, data_, sizeof(fh));
+  if (memcmp(fh.magic, kFileMagic, sizeof(fh.magic)) != 0 || fh.version != kFileVersion) {
+    close();
+    return EINVAL;
+  }
+
+  // Índice: só os cabeçalhos, pulando as colunas
+  size_t pos = sizeof(fh);
+  while (pos + sizeof(DiskBlock) <= size_) {
+    DiskBlock hdr;
+    memcpy(&hdr, data_ + pos, sizeof(hdr));
+    if (hdr.magic != kBlockMagic)
+      break;
+
+    size_t total = 0;
+    for (size_t c = 0; c < kNumColumns; c++)
+      total += hdr.col_size[c];
+    if (total > size_ - pos - sizeof(hdr))
+      break;
+
+    BlockRef ref;
+    ref.offset = pos + sizeof(hdr);
+    ref.lamp = hdr.lamp;
+    ref.count = hdr.count;
+    ref.t_min = hdr.t_min;
+    ref.t_max = hdr.t_max;
+    memcpy(ref.min, hdr.min, sizeof(ref.min));
+    memcpy(ref.max, hdr.max, sizeof(ref.max));
+    memcpy(ref.col_size, hdr.col_size, sizeof(ref.col_size));
+    blocks_.push_back(ref);
+
+    pos += sizeof(hdr) + total;
+  }
+
+  int ret = load_names(names_path(path), &ids_);
+  if (ret)
+    close();
+  return ret;
+}
+
+void SeriesReader::close() {
+  if (data_)
+    munmap(const_cast<uint8_t *>(data_), size_);
+  data_ = nullptr;
+  size_ = 0;
+  blocks_.clear();
+  ids_.clear();
+}
+
+bool SeriesReader::lamp_id(const std::string &name, uint16_t *id) const {
+  auto it = ids_.find(name);
+  if (it == ids_.end())
+    return false;
+  *id = it->second;
+  return true;
+}
+
+// Decodifica um bloco inteiro; um bloco corrompido rende só o prefixo válido
+void SeriesReader::decode(const BlockRef &block, std::vector<Sample> *out) const {
+  ColumnDecoder col[kNumColumns];
+  const uint8_t *p = data_ + block.offset;
+
+  for (size_t c = 0; c < kNumColumns; c++) {
+    col[c] = ColumnDecoder(p, p + block.col_size[c]);
+    p += block.col_size[c];
+  }
+
+  // Somas sem sinal: num bloco corrompido as diferenças podem ser qualquer
+  // coisa, e estourar uma soma com sinal seria comportamento indefinido.
+  // Para um bloco íntegro o resultado é o mesmo.
+  uint64_t time = block.t_min, delta = 0;
+  uint32_t prev[4] = {};
+  for (size_t i = 0; i < block.count; i++) {
+    Sample s;
+    int64_t d;
+
+    if (i > 0) {
+      if (!col[0].get(&d))
+        return;
+      delta += (uint64_t)d;
+      time += delta;
+    }
+    s.time_ms = (int64_t)time;
+
+    for (size_t c = 0; c < 4; c++) {
+      if (!col[c + 1].get(&d))
+        return;
+      prev[c] += (uint32_t)d;
+      *column_ptr(&s, c) = (int32_t)prev[c];
+    }
+    out->push_back(s);
+  }
+}
+
+std::vector<Sample> SeriesReader::query(uint16_t lamp, int64_t from, int64_t to) const {
+  std::vector<Sample> result, tmp;
+
+  for (const BlockRef &block : blocks_) {
+    if (block.lamp != lamp || block.t_max < from || block.t_min > to)
+      continue;
+    tmp.clear();
+    decode(block, &tmp);
+    for (const Sample &s : tmp)
+      if (s.time_ms >= from && s.time_ms <= to)
+        result.push_back(s);
+  }
+  return result;
+}
+
+std::vector<Sample> SeriesReader::query(uint16_t lamp, int64_t from, int64_t to,
+                                        Column column, int32_t lo, int32_t hi) const {
+  std::vector<Sample> result, tmp;
+  size_t c = static_cast<size_t>(column);
+
+  for (const BlockRef &block : blocks_) {
+    if (block.lamp != lamp || block.t_max < from || block.t_min > to ||
+        block.max[c] < lo || block.min[c] > hi)
+      continue;
+    tmp.clear();
+    decode(block, &tmp);
+    for (const Sample &s : tmp) {
+      int32_t v = column_value(s, c);
+      if (s.time_ms >= from && s.time_ms <= to && v >= lo && v <= hi)
+        result.push_back(s);
+    }
+  }
+  return result;
+}
+
+Summary SeriesReader::summarize(uint16_t lamp, int64_t from, int64_t to) const {
+  Summary sum;
+  std::vector<Sample> tmp;
+
+  auto merge = [&sum](const int32_t *mins, const int32_t *maxs, size_t count) {
+    for (size_t c = 0; c < 4; c++) {
+      sum.min[c] = sum.count ? std::min(sum.min[c], mins[c]) : mins[c];
+      sum.max[c] = sum.count ? std::max(sum.max[c], maxs[c]) : maxs[c];
+    }
+    sum.count += count;
+  };
+
+  for (const BlockRef &block : blocks_) {
+    if (block.lamp != lamp || block.t_max < from || block.t_min > to)
+      continue;
+
+    if (block.t_min >= from && block.t_max <= to) {
+      merge(block.min, block.max, block.count);
+      continue;
+    }
+
+    tmp.clear();
+    decode(block, &tmp);
+    for (const Sample &s : tmp) {
+      if (s.time_ms < from || s.time_ms > to)
+        continue;
+      int32_t v[4] = {s.ldr, s.led, s.temp_centi, s.hum_centi};
+      merge(v, v, 1);
+    }
+  }
+  return sum;
+}
+
+} // namespace smartlamp
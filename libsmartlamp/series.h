@@ -0,0 +1,136 @@
+#ifndef LIBSMARTLAMP_SERIES_H
+#define LIBSMARTLAMP_SERIES_H
+
+// Armazenamento do histórico das lâmpadas em arquivo colunar, só de anexar.
+//
+// O arquivo é uma sequência de blocos; cada bloco guarda até kBlockSamples
+// amostras de uma lâmpada, coluna por coluna:
+//   - tempo: primeiro valor no cabeçalho, depois delta-do-delta;
+//   - ldr, led, temp e hum: delta para o valor anterior. temp e hum ficam em
+//     centésimos (ponto fixo), sem float no arquivo.
+// As diferenças vão em zigzag+varint, e sequências de diferenças nulas (taxa
+// constante, sensor parado) viram uma única ficha, então uma coluna estável
+// custa poucos bytes por bloco.
+// O cabeçalho de cada bloco tem o intervalo de tempo e o mínimo/máximo de cada
+// coluna, o que permite pular blocos inteiros nas consultas sem decodificá-los.
+//
+// Cada bloco é gravado com um único write(); se o processo cair no meio, o
+// leitor ignora o bloco incompleto no fim do arquivo.
+//
+// Os blocos identificam a lâmpada por um número. A relação entre esse número
+// e o nome estável da lâmpada (LampInfo::name) fica ao lado, em
+// "<arquivo>.lamps", uma linha "<número> <nome>" por lâmpada, para que a
+// ordem em que as lâmpadas são encontradas não troque as séries.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace smartlamp {
+
+// Uma amostra de uma lâmpada
+struct Sample {
+  int64_t time_ms;    // Milissegundos desde a época (CLOCK_REALTIME)
+  int32_t ldr;        // 0..100
+  int32_t led;        // 0..100
+  int32_t temp_centi; // Centésimos de °C (23.5 °C -> 2350)
+  int32_t hum_centi;  // Centésimos de % (55.2 % -> 5520)
+};
+
+enum class Column { Ldr = 0, Led = 1, Temp = 2, Hum = 3 };
+
+const size_t kBlockSamples = 1024;
+
+class SeriesWriter {
+public:
+  SeriesWriter() = default;
+  ~SeriesWriter();
+
+  SeriesWriter(const SeriesWriter &) = delete;
+  SeriesWriter &operator=(const SeriesWriter &) = delete;
+
+  // Abre (ou cria) o arquivo para anexar. Retorna 0 ou errno.
+  int open(const std::string &path);
+
+  // Número da série da lâmpada com esse nome; um nome novo recebe o próximo
+  // número livre, gravado no .lamps. Retorna 0 ou errno.
+  int lamp_id(const std::string &name, uint16_t *id);
+
+  // Guarda uma amostra; o bloco da lâmpada vai para o disco quando enche.
+  // As amostras de uma lâmpada devem vir em ordem de tempo.
+  int append(uint16_t lamp, const Sample &sample);
+
+  // Grava os blocos incompletos de todas as lâmpadas. Chamado de tempos em
+  // tempos, limita o que se perde numa queda ao custo de blocos menores.
+  int flush();
+  int close();
+
+private:
+  int fd_ = -1;
+  std::string names_path_;
+  std::map<std::string, uint16_t> ids_;
+  std::map<uint16_t, std::vector<Sample>> pending_;
+
+  int write_block(uint16_t lamp, const std::vector<Sample> &samples);
+};
+
+// Mínimo e máximo de cada coluna num intervalo
+struct Summary {
+  size_t count = 0;
+  int32_t min[4] = {};
+  int32_t max[4] = {};
+};
+
+class SeriesReader {
+public:
+  SeriesReader() = default;
+  ~SeriesReader();
+
+  SeriesReader(const SeriesReader &) = delete;
+  SeriesReader &operator=(const SeriesReader &) = delete;
+
+  // Mapeia o arquivo e lê o índice (cabeçalhos dos blocos) e os nomes das
+  // lâmpadas. Retorna 0 ou errno.
+  int open(const std::string &path);
+  void close();
+
+  // Número da série da lâmpada com esse nome; false se não há série dela
+  bool lamp_id(const std::string &name, uint16_t *id) const;
+
+  // Amostras da lâmpada com time_ms em [from, to]
+  std::vector<Sample> query(uint16_t lamp, int64_t from, int64_t to) const;
+
+  // Mesma consulta, mas só amostras com a coluna dentro de [lo, hi]; blocos
+  // cujo mínimo/máximo não cruza [lo, hi] nem são decodificados
+  std::vector<Sample> query(uint16_t lamp, int64_t from, int64_t to,
+                            Column column, int32_t lo, int32_t hi) const;
+
+  // Mínimo/máximo no intervalo. Blocos inteiramente dentro dele usam só o
+  // cabeçalho; apenas os das pontas são decodificados.
+  Summary summarize(uint16_t lamp, int64_t from, int64_t to) const;
+
+private:
+  // Cabeçalho de um bloco já validado e a posição das suas colunas no mapa
+  struct BlockRef {
+    size_t offset;
+    uint16_t lamp;
+    uint16_t count;
+    int64_t t_min, t_max;
+    int32_t min[4], max[4];
+    uint32_t col_size[5];
+  };
+
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+  std::vector<BlockRef> blocks_;
+  std::map<std::string, uint16_t> ids_;
+
+  void decode(const BlockRef &block, std::vector<Sample> *out) const;
+};
+
+} // namespace smartlamp
+
+#endif
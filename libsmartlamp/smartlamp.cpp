@@ -0,0 +1,321 @@
+#include "smartlamp.h"
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "smartlamp_parse.h"
+
+namespace smartlamp {
+
+namespace {
+
+const Sensor kSensors[] = {Sensor::Led, Sensor::Ldr, Sensor::Temp, Sensor::Hum};
+const size_t kNumSensors = sizeof(kSensors) / sizeof(kSensors[0]);
+
+bool is_lamp_dir(const std::string &path) {
+  struct stat st;
+  return stat((path + "/ldr").c_str(), &st) == 0 &&
+         stat((path + "/led").c_str(), &st) == 0;
+}
+
+// Lê um arquivo do sysfs desde o início. O pread na posição 0 faz o driver
+// executar o attr_show de novo, então o fd pode ficar aberto.
+int read_milli(int fd, long *milli) {
+  char buf[64];
+  ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+  if (n < 0)
+    return errno;
+  while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == ' '))
+    n--;
+  buf[n] = '\0';
+  return -converter_milesimos(buf, milli);
+}
+
+int write_int(int fd, int value) {
+  char buf[16];
+  int len = snprintf(buf, sizeof(buf), "%d\n", value);
+  if (pwrite(fd, buf, len, 0) < 0)
+    return errno;
+  return 0;
+}
+
+} // namespace
+
+const char *sensor_name(Sensor sensor) {
+  switch (sensor) {
+  case Sensor::Led:
+    return "led";
+  case Sensor::Ldr:
+    return "ldr";
+  case Sensor::Temp:
+    return "temp";
+  case Sensor::Hum:
+    return "hum";
+  }
+  return "?";
+}
+
+std::vector<LampInfo> discover(const std::string &sysfs_root) {
+  std::vector<LampInfo> found;
+
+  // Driver USB: um único diretório em /sys/kernel/smartlamp
+  std::string usb = sysfs_root + "/kernel/smartlamp";
+  if (is_lamp_dir(usb))
+    found.push_back({"smartlamp", usb});
+
+  // Driver serdev: um diretório por UART associada ao driver
+  std::string serdev = sysfs_root + "/bus/serial/drivers/smartlamp_serdev";
+  if (DIR *dir = opendir(serdev.c_str())) {
+    while (struct dirent *ent = readdir(dir)) {
+      std::string path = serdev + "/" + ent->d_name;
+      if (ent->d_name[0] != '.' && is_lamp_dir(path))
+        found.push_back({ent->d_name, path});
+    }
+    closedir(dir);
+  }
+
+  return found;
+}
+
+// Estado de uma lâmpada: os fds abertos e os pedidos ainda não executados.
+// Tudo que não é fd é protegido por Impl::mutex.
+struct Lamp {
+  LampInfo info;
+  int fds[kNumSensors] = {-1, -1, -1, -1};
+
+  std::vector<Callback> reads[kNumSensors]; // Quem espera cada leitura
+  bool has_write = false;
+  int write_value = 0;                      // Último valor pedido para o LED
+  std::vector<Callback> writes;             // Quem espera a escrita
+  bool queued = false;                      // Está na fila ready ou em execução
+
+  bool pending() const {
+    if (has_write)
+      return true;
+    for (const auto &r : reads)
+      if (!r.empty())
+        return true;
+    return false;
+  }
+};
+
+struct Client::Impl {
+  std::map<std::string, std::unique_ptr<Lamp>> lamps;
+  mutable std::mutex mutex;
+  std::condition_variable cond;
+  std::deque<Lamp *> ready; // Lâmpadas com pedidos esperando uma thread
+  bool stopping = false;
+  std::vector<std::thread> threads;
+
+  void open(const std::vector<LampInfo> &infos) {
+    for (const auto &info : infos) {
+      std::unique_ptr<Lamp> lamp(new Lamp);
+      lamp->info = info;
+      for (size_t i = 0; i < kNumSensors; i++) {
+        std::string file = info.path + "/" + sensor_name(kSensors[i]);
+        int flags = kSensors[i] == Sensor::Led ? O_RDWR : O_RDONLY;
+        lamp->fds[i] = ::open(file.c_str(), flags | O_CLOEXEC);
+        if (lamp->fds[i] < 0 && kSensors[i] == Sensor::Led)
+          lamp->fds[i] = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+      }
+      lamps[info.name] = std::move(lamp);
+    }
+  }
+
+  void start(unsigned workers) {
+    if (workers == 0)
+      workers = 1;
+    for (unsigned i = 0; i < workers; i++)
+      threads.emplace_back([this] { run(); });
+  }
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    cond.notify_all();
+    for (auto &t : threads)
+      t.join();
+    for (auto &entry : lamps)
+      for (int fd : entry.second->fds)
+        if (fd >= 0)
+          close(fd);
+  }
+
+  // Coloca a lâmpada na fila se ela ainda não estiver lá. Chamado com mutex.
+  void schedule(Lamp *lamp) {
+    if (!lamp->queued) {
+      lamp->queued = true;
+      ready.push_back(lamp);
+      cond.notify_one();
+    }
+  }
+
+  Lamp *find(const std::string &name) {
+    auto it = lamps.find(name);
+    return it == lamps.end() ? nullptr : it->second.get();
+  }
+
+  void enqueue_read(const std::string &name, Sensor sensor, Callback cb) {
+    std::unique_lock<std::mutex> lock(mutex);
+    Lamp *lamp = find(name);
+    if (!lamp) {
+      lock.unlock();
+      cb({ENODEV, 0});
+      return;
+    }
+    lamp->reads[static_cast<size_t>(sensor)].push_back(std::move(cb));
+    schedule(lamp);
+  }
+
+  void enqueue_write(const std::string &name, int value, Callback cb) {
+    std::unique_lock<std::mutex> lock(mutex);
+    Lamp *lamp = find(name);
+    if (!lamp) {
+      lock.unlock();
+      cb({ENODEV, 0});
+      return;
+    }
+    lamp->has_write = true;
+    lamp->write_value = value;
+    lamp->writes.push_back(std::move(cb));
+    schedule(lamp);
+  }
+
+  // Executa tudo que estava pendente em uma lâmpada: primeiro a escrita
+  // (para que um get_led depois de set_led veja o novo valor), depois uma
+  // leitura por sensor para todos que a pediram.
+  void service(Lamp *lamp, std::unique_lock<std::mutex> &lock) {
+    bool has_write = lamp->has_write;
+    int value = lamp->write_value;
+    std::vector<Callback> writes;
+    std::vector<Callback> reads[kNumSensors];
+
+    writes.swap(lamp->writes);
+    lamp->has_write = false;
+    for (size_t i = 0; i < kNumSensors; i++)
+      reads[i].swap(lamp->reads[i]);
+
+    lock.unlock();
+
+    if (has_write) {
+      int fd = lamp->fds[static_cast<size_t>(Sensor::Led)];
+      Result res = {fd < 0 ? ENODEV : write_int(fd, value), value * 1000L};
+      for (auto &cb : writes)
+        cb(res);
+    }
+
+    for (size_t i = 0; i < kNumSensors; i++) {
+      if (reads[i].empty())
+        continue;
+      Result res = {ENODEV, 0};
+      if (lamp->fds[i] >= 0)
+        res.error = read_milli(lamp->fds[i], &res.milli);
+      for (auto &cb : reads[i])
+        cb(res);
+    }
+
+    lock.lock();
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+      cond.wait(lock, [this] { return stopping || !ready.empty(); });
+      if (ready.empty())
+        return;
+
+      Lamp *lamp = ready.front();
+      ready.pop_front();
+      service(lamp, lock);
+
+      // Pedidos que chegaram durante a execução vão para o fim da fila,
+      // para não monopolizar a thread com uma única lâmpada
+      lamp->queued = false;
+      if (lamp->pending())
+        schedule(lamp);
+    }
+  }
+};
+
+Client::Client(unsigned workers) : Client(discover(), workers) {}
+
+Client::Client(const std::vector<LampInfo> &lamps, unsigned workers)
+    : impl_(new Impl) {
+  impl_->open(lamps);
+  impl_->start(workers);
+}
+
+Client::~Client() { impl_->stop(); }
+
+std::vector<std::string> Client::lamps() const {
+  std::vector<std::string> names;
+  for (const auto &entry : impl_->lamps)
+    names.push_back(entry.first);
+  return names;
+}
+
+void Client::read(const std::string &lamp, Sensor sensor, Callback cb) {
+  impl_->enqueue_read(lamp, sensor, std::move(cb));
+}
+
+void Client::write_led(const std::string &lamp, int value, Callback cb) {
+  impl_->enqueue_write(lamp, value, std::move(cb));
+}
+
+std::future<long> Client::get(const std::string &lamp, Sensor sensor) {
+  auto promise = std::make_shared<std::promise<long>>();
+  std::future<long> future = promise->get_future();
+  read(lamp, sensor, [promise](const Result &res) {
+    if (res.error)
+      promise->set_exception(std::make_exception_ptr(
+          std::system_error(res.error, std::generic_category())));
+    else
+      promise->set_value(res.milli);
+  });
+  return future;
+}
+
+std::future<long> Client::get_ldr(const std::string &lamp) {
+  return get(lamp, Sensor::Ldr);
+}
+
+std::future<long> Client::get_temp(const std::string &lamp) {
+  return get(lamp, Sensor::Temp);
+}
+
+std::future<long> Client::get_hum(const std::string &lamp) {
+  return get(lamp, Sensor::Hum);
+}
+
+std::future<long> Client::get_led(const std::string &lamp) {
+  return get(lamp, Sensor::Led);
+}
+
+std::future<void> Client::set_led(const std::string &lamp, int value) {
+  auto promise = std::make_shared<std::promise<void>>();
+  std::future<void> future = promise->get_future();
+  write_led(lamp, value, [promise](const Result &res) {
+    if (res.error)
+      promise->set_exception(std::make_exception_ptr(
+          std::system_error(res.error, std::generic_category())));
+    else
+      promise->set_value();
+  });
+  return future;
+}
+
+} // namespace smartlamp
@@ -0,0 +1,80 @@
+#ifndef LIBSMARTLAMP_SMARTLAMP_H
+#define LIBSMARTLAMP_SMARTLAMP_H
+
+// Biblioteca cliente do SmartLamp. Encontra as lâmpadas expostas pelos
+// drivers (smartlamp.ko em /sys/kernel/smartlamp e smartlamp_serdev.ko em
+// /sys/bus/serial/drivers/smartlamp_serdev), mantém os arquivos de cada uma
+// abertos e faz as leituras/escritas em threads de trabalho, devolvendo
+// futures ou chamando callbacks.
+//
+// Pedidos simultâneos para a mesma lâmpada e sensor são agrupados: quem pedir
+// enquanto uma leitura ainda está na fila recebe o resultado da mesma leitura,
+// e escritas no LED ainda não enviadas são substituídas pela mais recente.
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace smartlamp {
+
+enum class Sensor { Led, Ldr, Temp, Hum };
+
+// Nome do arquivo do sensor no sysfs ("led", "ldr", "temp", "hum")
+const char *sensor_name(Sensor sensor);
+
+// Lâmpada encontrada no sysfs
+struct LampInfo {
+  std::string name; // "smartlamp" (USB) ou o nome do dispositivo serdev
+  std::string path; // Diretório com os arquivos led, ldr, temp e hum
+};
+
+// Procura as lâmpadas a partir de sysfs_root (normalmente "/sys")
+std::vector<LampInfo> discover(const std::string &sysfs_root = "/sys");
+
+// Resultado de uma operação: error é 0 ou um errno; milli é o valor em
+// milésimos, como o driver (23.5 °C -> 23500, LDR 57 -> 57000)
+struct Result {
+  int error;
+  long milli;
+};
+
+using Callback = std::function<void(const Result &)>;
+
+class Client {
+public:
+  // Abre as lâmpadas encontradas por discover() e inicia `workers` threads.
+  // Cada thread atende uma lâmpada por vez, então até `workers` lâmpadas
+  // são acessadas em paralelo.
+  explicit Client(unsigned workers = 4);
+  Client(const std::vector<LampInfo> &lamps, unsigned workers = 4);
+  ~Client();
+
+  Client(const Client &) = delete;
+  Client &operator=(const Client &) = delete;
+
+  // Nomes das lâmpadas abertas
+  std::vector<std::string> lamps() const;
+
+  // Leituras em milésimos. O future lança std::system_error em caso de erro.
+  std::future<long> get_ldr(const std::string &lamp);
+  std::future<long> get_temp(const std::string &lamp);
+  std::future<long> get_hum(const std::string &lamp);
+  std::future<long> get_led(const std::string &lamp);
+  std::future<void> set_led(const std::string &lamp, int value);
+
+  // Mesmas operações com callback, chamado em uma thread de trabalho
+  void read(const std::string &lamp, Sensor sensor, Callback cb);
+  void write_led(const std::string &lamp, int value, Callback cb);
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+
+  std::future<long> get(const std::string &lamp, Sensor sensor);
+};
+
+} // namespace smartlamp
+
+#endif
@@ -1,43 +1,157 @@
 #include <linux/module.h>
 #include <linux/usb.h>
+#include <linux/usb/cdc.h>
 #include <linux/slab.h>
 #include <linux/kobject.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/completion.h>
+#include <linux/workqueue.h>
 #include <linux/string.h>
 #include <linux/ctype.h>
+#include <linux/jiffies.h>
+#include <linux/timekeeping.h>
+
+#include "smartlamp_clock.h"
+#include "smartlamp_parse.h"
 
 MODULE_AUTHOR("DevTITANS <devtitans@icomp.ufam.edu.br>");
-MODULE_DESCRIPTION("Driver de acesso ao SmartLamp (ESP32 com Chip Serial CP2102)");
+MODULE_DESCRIPTION("Driver de acesso ao SmartLamp (ESP32 com Chip Serial CP2102 ou USB nativo CDC-ACM)");
 MODULE_LICENSE("GPL");
 
 #define MAX_RECV_LINE 100
-#define VENDOR_ID   0x10C4
+#define RESPONSE_TIMEOUT_MS 3000
+#define VENDOR_ID   0x10C4   // CP2102 (Silicon Labs)
 #define PRODUCT_ID  0xEA60
-#define MAX_NUM_STR_SIZE 32
+#define ESPRESSIF_VENDOR_ID      0x303A
+#define ESPRESSIF_USB_SERIAL_JTAG 0x1001 // USB nativo do ESP32-S3/C3/C6 (USBSerial)
+
+static uint baudrate = 115200; // Deve ser igual ao Serial.begin() do firmware
+module_param(baudrate, uint, 0444);
+MODULE_PARM_DESC(baudrate, "Baud rate da serial do ESP32 (padrão 115200)");
+
+// Cada placa fala com o host por um transporte diferente: o CP2102 precisa de
+// mensagens de controle do fabricante, o USB nativo usa as requisições da
+// classe CDC-ACM. Depois de configurado, ambos trocam os comandos pelos
+// mesmos endpoints bulk.
+struct smartlamp_transport {
+    const char *name;
+    int (*config_serial)(struct usb_interface *interface);
+};
+
+static int cp210x_config_serial(struct usb_interface *interface);
+static int cdc_acm_config_serial(struct usb_interface *interface);
+
+static const struct smartlamp_transport cp210x_transport = {
+    .name          = "cp210x",
+    .config_serial = cp210x_config_serial,
+};
+
+static const struct smartlamp_transport cdc_acm_transport = {
+    .name          = "cdc-acm",
+    .config_serial = cdc_acm_config_serial,
+};
 
 static struct usb_device *smartlamp_device;
+static const struct smartlamp_transport *smartlamp_transport;
 static uint usb_in, usb_out;
 static char *usb_in_buffer, *usb_out_buffer;
 static int usb_max_size;
+static DEFINE_MUTEX(usb_lock);  // Serializa os comandos: os buffers acima são compartilhados
+
+// Recepção: um URB bulk-in fica sempre submetido e o usb_rx_complete monta as
+// linhas. Respostas ("RES ..."/"ERR ...") vão para o comando pendente e
+// amostras de assinatura ("EVT ...") para uma fila tratada por usb_evt_work,
+// que pode travar usb_lock. Os campos abaixo são protegidos por usb_rx_lock.
+#define EVT_FILA 8
+static struct urb *usb_rx_urb;
+static DEFINE_SPINLOCK(usb_rx_lock);
+static bool usb_rx_ativo;                   // URB submetido
+static bool usb_rx_parar;                   // Desconectando: não submeter de novo
+static char usb_rx_line[MAX_RECV_LINE];     // Linha sendo montada
+static size_t usb_rx_len;
+static bool usb_rx_overflow;                // Linha atual passou de MAX_RECV_LINE
+static char usb_resp_line[MAX_RECV_LINE];   // Última resposta entregue ao comando
+static bool usb_esperando;                  // Há um comando esperando resposta
+static const char *usb_esperado;            // Comando que espera (se usb_esperando)
+static s64 usb_resp_ns;                     // Quando a resposta chegou
+static DECLARE_COMPLETION(usb_resp_done);
+static char usb_evt_fila[EVT_FILA][MAX_RECV_LINE];
+static unsigned int usb_evt_ini, usb_evt_n;
+static void usb_evt_work_fn(struct work_struct *work);
+static DECLARE_WORK(usb_evt_work, usb_evt_work_fn);
+
+// Carimbos de tempo do firmware (SET_STAMP). Protegidos por usb_lock.
+enum { CARIMBO_DESCONHECIDO, CARIMBO_ATIVO, CARIMBO_SEM_SUPORTE };
+enum { SENSOR_LED, SENSOR_LDR, SENSOR_TEMP, SENSOR_HUM, NUM_SENSORES };
+static int usb_carimbo;
+static bool usb_inteiros;  // SET_FORMAT 1 aceito: o DHT vem em escala fixa
+static struct smartlamp_relogio usb_relogio;
+static s64 usb_amostra_ns[NUM_SENSORES];  // Quando cada valor foi lido no ESP32 (ktime_get_ns)
+
+// Temperatura, umidade e índice de calor chegam juntos pelo GET_DHT e ficam
+// guardados por DHT_CACHE_MS, então ler temp, hum e heat_index em seguida
+// custa uma transação só. Protegido por usb_lock.
+#define DHT_CACHE_MS 1000
+static struct {
+    bool valido;
+    bool sem_suporte;        // Firmware antigo: usa GET_TEMP/GET_HUM
+    unsigned long lido_em;   // jiffies
+    long temp, hum, indice;  // Milésimos
+    s64 amostra_ns;
+} usb_dht;
+
+// Assinaturas (SUBSCRIBE no firmware): o ESP32 envia os valores sozinhos a
+// cada período e a leitura dos atributos usa o último recebido, sem
+// transação. Se as amostras param de chegar (ESP32 reiniciou, por exemplo),
+// a leitura volta a mandar comandos. Protegido por usb_lock.
+#define ASSINATURA_MAX_MS   3600000
+#define ASSINATURA_FOLGA_MS 100   // Atraso tolerado além de dois períodos
+#define ASSINATURA_MAX_ABS  10000 // Limiar do SET_REPORT, em décimos
+enum { ASSINA_LED, ASSINA_LDR, ASSINA_DHT, NUM_ASSINATURAS };
+static const char *const nomes_assinatura[NUM_ASSINATURAS] = { "LED", "LDR", "DHT" };
+static struct {
+    unsigned int periodo_ms;   // 0 = sem assinatura
+    bool relato;               // Só envia mudanças (SET_REPORT com limiar)
+    unsigned int maximo_ms;    // Intervalo máximo entre envios (0 = sem)
+    bool valido;
+    unsigned long recebido_em; // jiffies
+    long valor;                // LED e LDR em milésimos; o DHT vai para usb_dht
+    s64 amostra_ns;
+} usb_assinatura[NUM_ASSINATURAS];
 
 static const struct usb_device_id id_table[] = {
     { USB_DEVICE(VENDOR_ID, PRODUCT_ID) },
+    // Só a interface de dados; a de controle é encontrada no probe. O cdc_acm
+    // pega as duas antes, então é preciso soltá-las dele (ver README.md)
+    { USB_DEVICE_INTERFACE_CLASS(ESPRESSIF_VENDOR_ID, ESPRESSIF_USB_SERIAL_JTAG, USB_CLASS_CDC_DATA) },
     {}
 };
 
 static int usb_probe(struct usb_interface *ifce, const struct usb_device_id *id);
 static void usb_disconnect(struct usb_interface *ifce);
-static long usb_send_cmd(const char *cmd, int param);
+static int usb_send_cmd(const char *cmd, int param, long *value, s64 *stamp_ns);
 
 static ssize_t attr_show(struct kobject *sys_obj, struct kobj_attribute *attr, char *buff);
 static ssize_t attr_store(struct kobject *sys_obj, struct kobj_attribute *attr, const char *buff, size_t count);
+static ssize_t stamps_show(struct kobject *sys_obj, struct kobj_attribute *attr, char *buff);
+static ssize_t clock_show(struct kobject *sys_obj, struct kobj_attribute *attr, char *buff);
+static ssize_t subscribe_show(struct kobject *sys_obj, struct kobj_attribute *attr, char *buff);
+static ssize_t subscribe_store(struct kobject *sys_obj, struct kobj_attribute *attr, const char *buff, size_t count);
 
 static struct kobj_attribute led_attribute = __ATTR(led, S_IRUGO | S_IWUSR, attr_show, attr_store);
 static struct kobj_attribute ldr_attribute = __ATTR(ldr, S_IRUGO | S_IWUSR, attr_show, attr_store);
 static struct kobj_attribute temp_attribute = __ATTR(temp, S_IRUGO | S_IWUSR, attr_show, attr_store);
 static struct kobj_attribute hum_attribute = __ATTR(hum, S_IRUGO | S_IWUSR, attr_show, attr_store);
+static struct kobj_attribute heat_index_attribute = __ATTR(heat_index, S_IRUGO, attr_show, NULL);
+static struct kobj_attribute stamps_attribute = __ATTR(stamps, S_IRUGO, stamps_show, NULL);
+static struct kobj_attribute clock_attribute = __ATTR(clock, S_IRUGO, clock_show, NULL);
+static struct kobj_attribute subscribe_attribute = __ATTR(subscribe, S_IRUGO | S_IWUSR, subscribe_show, subscribe_store);
 
 
-static struct attribute *attrs[] = { &led_attribute.attr, &ldr_attribute.attr, &temp_attribute.attr, &hum_attribute.attr, NULL };
+static struct attribute *attrs[] = { &led_attribute.attr, &ldr_attribute.attr, &temp_attribute.attr, &hum_attribute.attr,
+                                     &heat_index_attribute.attr, &stamps_attribute.attr, &clock_attribute.attr,
+                                     &subscribe_attribute.attr, NULL };
 static struct attribute_group attr_group = { .attrs = attrs };
 static struct kobject *sys_obj;
 
@@ -50,274 +164,695 @@ static struct usb_driver smartlamp_driver = {
 
 module_usb_driver(smartlamp_driver);
 
-static int smartlamp_config_serial(struct usb_device *dev)
+// Envia uma mensagem de controle host->dispositivo. O buffer passado para o
+// usb_control_msg precisa servir para DMA, então os dados são copiados para
+// memória do kmalloc em vez de usar variáveis da pilha.
+static int smartlamp_control_out(struct usb_device *dev, u8 request, u8 requesttype,
+                                 u16 value, u16 index, const void *data, u16 size)
 {
+    void *buf = NULL;
+    int ret;
+
+    if (size) {
+        buf = kmemdup(data, size, GFP_KERNEL);
+        if (!buf)
+            return -ENOMEM;
+    }
+
+    ret = usb_control_msg(dev, usb_sndctrlpipe(dev, 0), request, requesttype,
+                          value, index, buf, size, 1000);
+    kfree(buf);
+    return ret < 0 ? ret : 0;
+}
+
+// Configura o CP2102 com mensagens de controle do fabricante (Silicon Labs)
+static int cp210x_config_serial(struct usb_interface *interface)
+{
+    struct usb_device *dev = interface_to_usbdev(interface);
+    u16 ifnum = interface->cur_altsetting->desc.bInterfaceNumber;
+    __le32 rate = cpu_to_le32(baudrate);
     int ret;
-    u32 baudrate = 9600;
 
     printk(KERN_INFO "SmartLamp: Configurando a porta serial...\n");
 
-    ret = usb_control_msg(dev, usb_sndctrlpipe(dev, 0),
-                          0x00, 0x41, 0x0001, 0, NULL, 0, 1000);
+    // CP210X_IFC_ENABLE (0x00), bmRequestType 0x41 (Vendor, Host-to-Device, Interface)
+    ret = smartlamp_control_out(dev, 0x00, 0x41, 0x0001, ifnum, NULL, 0);
     if (ret) {
         printk(KERN_ERR "SmartLamp: Erro ao habilitar a UART (código %d)\n", ret);
         return ret;
     }
 
-    ret = usb_control_msg(dev, usb_sndctrlpipe(dev, 0),
-                          0x1E, 0x41, 0, 0, &baudrate, sizeof(baudrate), 1000);
-    if (ret < 0) {
+    // CP210X_SET_BAUDRATE (0x1E)
+    ret = smartlamp_control_out(dev, 0x1E, 0x41, 0, ifnum, &rate, sizeof(rate));
+    if (ret) {
         printk(KERN_ERR "SmartLamp: Erro ao configurar o baud rate (código %d)\n", ret);
         return ret;
     }
 
-    printk(KERN_INFO "SmartLamp: Baud rate configurado para %d\n", baudrate);
+    printk(KERN_INFO "SmartLamp: Baud rate configurado para %u\n", baudrate);
+    return 0;
+}
+
+// Procura a interface de controle CDC-ACM que acompanha a interface de dados
+static int cdc_acm_control_ifnum(struct usb_device *dev)
+{
+    struct usb_host_config *config = dev->actconfig;
+    int i;
+
+    for (i = 0; config && i < config->desc.bNumInterfaces; i++) {
+        struct usb_interface_descriptor *desc = &config->interface[i]->cur_altsetting->desc;
+
+        if (desc->bInterfaceClass == USB_CLASS_COMM &&
+            desc->bInterfaceSubClass == USB_CDC_SUBCLASS_ACM)
+            return desc->bInterfaceNumber;
+    }
+    return -ENODEV;
+}
+
+// Configura o USB nativo do ESP32 com as requisições da classe CDC-ACM
+static int cdc_acm_config_serial(struct usb_interface *interface)
+{
+    struct usb_device *dev = interface_to_usbdev(interface);
+    struct usb_cdc_line_coding coding = {
+        .dwDTERate   = cpu_to_le32(baudrate),
+        .bCharFormat = USB_CDC_1_STOP_BITS,
+        .bParityType = USB_CDC_NO_PARITY,
+        .bDataBits   = 8,
+    };
+    int ifnum, ret;
+
+    ifnum = cdc_acm_control_ifnum(dev);
+    if (ifnum < 0) {
+        printk(KERN_ERR "SmartLamp: Interface de controle CDC-ACM não encontrada\n");
+        return ifnum;
+    }
+
+    ret = smartlamp_control_out(dev, USB_CDC_REQ_SET_LINE_CODING,
+                                USB_TYPE_CLASS | USB_RECIP_INTERFACE,
+                                0, ifnum, &coding, sizeof(coding));
+    if (ret) {
+        printk(KERN_ERR "SmartLamp: Erro no SET_LINE_CODING (código %d)\n", ret);
+        return ret;
+    }
+
+    // Só DTR: o USBSerial só envia dados com DTR ativo, e RTS sem DTR
+    // reinicia o ESP32
+    ret = smartlamp_control_out(dev, USB_CDC_REQ_SET_CONTROL_LINE_STATE,
+                                USB_TYPE_CLASS | USB_RECIP_INTERFACE,
+                                0x01, ifnum, NULL, 0);
+    if (ret) {
+        printk(KERN_ERR "SmartLamp: Erro no SET_CONTROL_LINE_STATE (código %d)\n", ret);
+        return ret;
+    }
+
+    printk(KERN_INFO "SmartLamp: USB CDC-ACM configurado\n");
     return 0;
 }
 
 MODULE_DEVICE_TABLE(usb, id_table);
 
-// Extrai último número (int ou float) como string
-static int extrair_ultimo_numero_str(const char *str, char *num_str, size_t sz)
+// Trata uma linha completa recebida. Chamado com usb_rx_lock travado.
+// Retorna true se a linha foi para a fila de amostras.
+static bool usb_rx_linha(void)
 {
-    const char *p = str;
-    const char *ultimo_ini = NULL;
-    const char *ultimo_fim = NULL;
-
-    while (*p) {
-        if ((*p == '+' || *p == '-' || isdigit(*p))) {
-            const char *start = p;
-            p++;
-            while (*p && (isdigit(*p) || *p == '.'))
-                p++;
-            ultimo_ini = start;
-            ultimo_fim = p;
-        } else {
-            p++;
+    if (usb_rx_overflow)
+        return false;
+
+    if (usb_esperando && linha_eh_resposta(usb_rx_line, usb_rx_len)) {
+        // Resposta atrasada de um comando que já deu timeout
+        if (!resposta_do_comando(usb_rx_line, usb_rx_len, usb_esperado)) {
+            printk(KERN_INFO "SmartLamp: Resposta fora de hora descartada: [%.*s]\n",
+                   (int)usb_rx_len, usb_rx_line);
+            return false;
         }
+        memcpy(usb_resp_line, usb_rx_line, usb_rx_len);
+        usb_resp_line[usb_rx_len] = '\0';
+        usb_resp_ns = ktime_get_ns();
+        usb_esperando = false;
+        complete(&usb_resp_done);
+        return false;
     }
-    if (ultimo_ini && ultimo_fim) {
-        size_t len = ultimo_fim - ultimo_ini;
-        if (len >= sz)
-            len = sz-1;
-        strncpy(num_str, ultimo_ini, len);
-        num_str[len] = '\0';
-        return 0;
+
+    if (!linha_eh_evento(usb_rx_line, usb_rx_len))
+        return false;  // Eco do comando
+    if (usb_evt_n == EVT_FILA) {
+        printk(KERN_ERR "SmartLamp: Fila de amostras cheia, descartando\n");
+        return false;
     }
-    num_str[0] = '\0';
-    return -1;
+    memcpy(usb_evt_fila[(usb_evt_ini + usb_evt_n) % EVT_FILA], usb_rx_line, usb_rx_len);
+    usb_evt_fila[(usb_evt_ini + usb_evt_n) % EVT_FILA][usb_rx_len] = '\0';
+    usb_evt_n++;
+    return true;
 }
 
-// Extrai último número, devolve int se possível, ou float*1000 (milésimos)
-static long extrair_ultimo_numero_kernel(const char *str)
+// Fim de cada transferência do URB de recepção (contexto de interrupção).
+// Monta as linhas e submete o URB de novo; em caso de erro ele fica parado
+// até o próximo comando (usb_rx_iniciar).
+static void usb_rx_complete(struct urb *urb)
 {
-    char num_str[MAX_NUM_STR_SIZE];
-    int int_val;
-    long fixed_val;
+    const char *data = urb->transfer_buffer;
+    unsigned long flags;
+    bool evento = false;
+    int i, ret;
+
+    spin_lock_irqsave(&usb_rx_lock, flags);
+    if (urb->status) {
+        // -ENOENT/-ECONNRESET/-ESHUTDOWN: URB cancelado ou dispositivo removido
+        if (urb->status != -ENOENT && urb->status != -ECONNRESET && urb->status != -ESHUTDOWN)
+            printk(KERN_ERR "SmartLamp: Erro %d na recepção\n", urb->status);
+        usb_rx_ativo = false;
+        spin_unlock_irqrestore(&usb_rx_lock, flags);
+        return;
+    }
 
-    if (extrair_ultimo_numero_str(str, num_str, sizeof(num_str)) < 0)
-        return -EINVAL;
+    for (i = 0; i < urb->actual_length; i++) {
+        char c = data[i];
+
+        if (c != '\n' && c != '\r') {
+            if (usb_rx_len < sizeof(usb_rx_line) - 1)
+                usb_rx_line[usb_rx_len++] = c;
+            else
+                usb_rx_overflow = true;
+            continue;
+        }
+        if (usb_rx_linha())
+            evento = true;
+        usb_rx_len = 0;
+        usb_rx_overflow = false;
+    }
+
+    ret = usb_rx_parar ? -ENODEV : usb_submit_urb(urb, GFP_ATOMIC);
+    if (ret) {
+        if (ret != -ENODEV)
+            printk(KERN_ERR "SmartLamp: Erro %d ao submeter a recepção\n", ret);
+        usb_rx_ativo = false;
+    }
+    spin_unlock_irqrestore(&usb_rx_lock, flags);
 
-    if (kstrtoint(num_str, 10, &int_val) == 0)
-        return int_val;
-
-    if (strchr(num_str, '.')) {
-        long inteiro = 0, mil = 0;
-        char temp[16];
-        char *dot = strchr(num_str, '.');
-        int intlen = dot - num_str;
-        int n;
-
-        if (intlen > 15)
-            intlen = 15;
-        strncpy(temp, num_str, intlen);
-        temp[intlen] = '\0';
-
-        if (kstrtol(temp, 10, &inteiro))
-            return -EINVAL;
-        if (kstrtol(dot+1, 10, &mil))
-            return -EINVAL;
-
-        n = strlen(dot+1);
-        while (n < 3) { mil *= 10; n++; }
-        while (n > 3) { mil /= 10; n--; }
-        if (inteiro < 0)
-            fixed_val = inteiro*1000 - mil;
+    if (evento)
+        schedule_work(&usb_evt_work);
+}
+
+// Garante que o URB de recepção está submetido
+static int usb_rx_iniciar(void)
+{
+    unsigned long flags;
+    int ret = 0;
+
+    spin_lock_irqsave(&usb_rx_lock, flags);
+    if (usb_rx_parar) {
+        ret = -ENODEV;
+    } else if (!usb_rx_ativo) {
+        ret = usb_submit_urb(usb_rx_urb, GFP_ATOMIC);
+        if (ret == 0)
+            usb_rx_ativo = true;
         else
-            fixed_val = inteiro*1000 + mil;
-        return fixed_val;
+            printk(KERN_ERR "SmartLamp: Erro %d ao submeter a recepção\n", ret);
+    }
+    spin_unlock_irqrestore(&usb_rx_lock, flags);
+    return ret;
+}
+
+// Com relato por mudança o firmware fica calado enquanto o valor não muda,
+// então o cache vale até o intervalo máximo entre envios. Sem esse máximo
+// não dá para distinguir silêncio de um ESP32 que reiniciou, e a leitura
+// volta a mandar comandos.
+static bool usb_assinatura_fresca(int fonte)
+{
+    unsigned int periodo = usb_assinatura[fonte].periodo_ms;
+
+    if (usb_assinatura[fonte].relato) {
+        if (!usb_assinatura[fonte].maximo_ms)
+            return false;
+        periodo = max(periodo, usb_assinatura[fonte].maximo_ms);
     }
-    return -EINVAL;
+    return usb_assinatura[fonte].periodo_ms && usb_assinatura[fonte].valido &&
+           time_before(jiffies, usb_assinatura[fonte].recebido_em +
+                                msecs_to_jiffies(2 * periodo + ASSINATURA_FOLGA_MS));
 }
 
+// Guarda uma amostra "EVT <sensor> <valores> [@S,R]" e acorda quem espera
+// por ela com poll() no atributo. Chamado com usb_lock travado.
+static void usb_tratar_evento_locked(char *line)
+{
+    unsigned long amostra, resposta;
+    long valores[4];
+    s64 stamp_ns = 0;
+    int fonte;
+
+    if (separar_carimbo(line, &amostra, &resposta) == 0) {
+        relogio_acompanhar(&usb_relogio, resposta);
+        stamp_ns = relogio_converter(&usb_relogio, amostra);
+    }
+
+    line += 4;  // "EVT "
+    for (fonte = 0; fonte < NUM_ASSINATURAS; fonte++) {
+        size_t len = strlen(nomes_assinatura[fonte]);
+
+        if (strncmp(line, nomes_assinatura[fonte], len) == 0 && line[len] == ' ')
+            break;
+    }
+    if (fonte == NUM_ASSINATURAS)
+        return;
+
+    if (fonte == ASSINA_DHT) {
+        // Mesmo formato do GET_DHT: "<temp> <hum> <indice> <ok>"
+        if (extrair_dht_kernel(line, usb_inteiros, valores))
+            return;
+        usb_dht.valido = true;
+        usb_dht.lido_em = jiffies;
+        usb_dht.temp = valores[0];
+        usb_dht.hum = valores[1];
+        usb_dht.indice = valores[2];
+        usb_dht.amostra_ns = stamp_ns;
+    } else {
+        if (extrair_numeros_kernel(line, valores, 1) != 1)
+            return;
+        usb_assinatura[fonte].valor = valores[0];
+    }
+    usb_assinatura[fonte].valido = true;
+    usb_assinatura[fonte].recebido_em = jiffies;
+    usb_assinatura[fonte].amostra_ns = stamp_ns;
+
+    if (!sys_obj)
+        return;
+    if (fonte == ASSINA_DHT) {
+        sysfs_notify(sys_obj, NULL, "temp");
+        sysfs_notify(sys_obj, NULL, "hum");
+        sysfs_notify(sys_obj, NULL, "heat_index");
+    } else {
+        sysfs_notify(sys_obj, NULL, fonte == ASSINA_LED ? "led" : "ldr");
+    }
+}
+
+static void usb_evt_work_fn(struct work_struct *work)
+{
+    char line[MAX_RECV_LINE];
+    unsigned long flags;
+    bool tem;
+
+    for (;;) {
+        spin_lock_irqsave(&usb_rx_lock, flags);
+        tem = usb_evt_n > 0;
+        if (tem) {
+            memcpy(line, usb_evt_fila[usb_evt_ini], sizeof(line));
+            usb_evt_ini = (usb_evt_ini + 1) % EVT_FILA;
+            usb_evt_n--;
+        }
+        spin_unlock_irqrestore(&usb_rx_lock, flags);
+        if (!tem)
+            break;
+
+        mutex_lock(&usb_lock);
+        usb_tratar_evento_locked(line);
+        mutex_unlock(&usb_lock);
+    }
+}
+
+
 static int usb_probe(struct usb_interface *interface, const struct usb_device_id *id) {
     struct usb_endpoint_descriptor *usb_endpoint_in, *usb_endpoint_out;
+    struct usb_device *dev = interface_to_usbdev(interface);
     int ret;
 
     printk(KERN_INFO "SmartLamp: Dispositivo conectado ...\n");
 
-    sys_obj = kobject_create_and_add("smartlamp", kernel_kobj);
-    if (!sys_obj)
-        return -ENOMEM;
+    if (smartlamp_device)
+        return -EBUSY;
 
-    ret = sysfs_create_group(sys_obj, &attr_group);
-    if (ret) {
-        kobject_put(sys_obj);
-        return ret;
-    }
+    // A interface de dados CDC identifica o USB nativo; o resto é CP2102
+    if (interface->cur_altsetting->desc.bInterfaceClass == USB_CLASS_CDC_DATA)
+        smartlamp_transport = &cdc_acm_transport;
+    else
+        smartlamp_transport = &cp210x_transport;
 
-    smartlamp_device = interface_to_usbdev(interface);
     ret = usb_find_common_endpoints(interface->cur_altsetting, &usb_endpoint_in, &usb_endpoint_out, NULL, NULL);
-    if (ret) {
-        kobject_put(sys_obj);
+    if (ret)
         return ret;
-    }
 
     usb_max_size = usb_endpoint_maxp(usb_endpoint_in);
     usb_in = usb_endpoint_in->bEndpointAddress;
     usb_out = usb_endpoint_out->bEndpointAddress;
     usb_in_buffer = kmalloc(usb_max_size, GFP_KERNEL);
     usb_out_buffer = kmalloc(usb_max_size, GFP_KERNEL);
-    if (!usb_in_buffer || !usb_out_buffer) {
+    usb_rx_urb = usb_alloc_urb(0, GFP_KERNEL);
+    if (!usb_in_buffer || !usb_out_buffer || !usb_rx_urb) {
         ret = -ENOMEM;
         goto fail_buffers;
     }
+    usb_fill_bulk_urb(usb_rx_urb, dev, usb_rcvbulkpipe(dev, usb_in),
+                      usb_in_buffer, usb_max_size, usb_rx_complete, NULL);
 
-    ret = smartlamp_config_serial(smartlamp_device);
+    ret = smartlamp_transport->config_serial(interface);
     if (ret) {
-        printk(KERN_ERR "SmartLamp: Falha na configuração da serial\n");
+        printk(KERN_ERR "SmartLamp: Falha na configuração da serial (%s)\n", smartlamp_transport->name);
+        goto fail_buffers;
+    }
+
+    sys_obj = kobject_create_and_add("smartlamp", kernel_kobj);
+    if (!sys_obj) {
+        ret = -ENOMEM;
         goto fail_buffers;
     }
 
+    ret = sysfs_create_group(sys_obj, &attr_group);
+    if (ret)
+        goto fail_kobject;
+
+    mutex_lock(&usb_lock);
+    smartlamp_device = dev;
+    usb_carimbo = CARIMBO_DESCONHECIDO;
+    usb_inteiros = false;
+    relogio_reiniciar(&usb_relogio);
+    memset(usb_amostra_ns, 0, sizeof(usb_amostra_ns));
+    memset(&usb_dht, 0, sizeof(usb_dht));
+    memset(usb_assinatura, 0, sizeof(usb_assinatura));
+
+    spin_lock_irq(&usb_rx_lock);
+    usb_rx_ativo = false;
+    usb_rx_parar = false;
+    usb_rx_len = 0;
+    usb_rx_overflow = false;
+    usb_esperando = false;
+    usb_evt_ini = usb_evt_n = 0;
+    spin_unlock_irq(&usb_rx_lock);
+    usb_rx_iniciar();  // Se falhar, o primeiro comando tenta de novo
+    mutex_unlock(&usb_lock);
+
+    printk(KERN_INFO "SmartLamp: Usando transporte %s\n", smartlamp_transport->name);
     return 0;
 
+fail_kobject:
+    kobject_put(sys_obj);
+    sys_obj = NULL;
 fail_buffers:
+    usb_free_urb(usb_rx_urb);
+    usb_rx_urb = NULL;
     kfree(usb_in_buffer);
     kfree(usb_out_buffer);
-    sysfs_remove_group(sys_obj, &attr_group);
-    kobject_put(sys_obj);
+    usb_in_buffer = NULL;
+    usb_out_buffer = NULL;
     return ret;
 }
 
 static void usb_disconnect(struct usb_interface *interface) {
     printk(KERN_INFO "SmartLamp: Dispositivo desconectado.\n");
+
+    // Para a recepção e acorda um comando que esteja esperando resposta
+    spin_lock_irq(&usb_rx_lock);
+    usb_rx_parar = true;
+    if (usb_esperando) {
+        usb_resp_line[0] = '\0';
+        usb_esperando = false;
+        complete(&usb_resp_done);
+    }
+    spin_unlock_irq(&usb_rx_lock);
+    usb_kill_urb(usb_rx_urb);
+    cancel_work_sync(&usb_evt_work);
+
     if (sys_obj) {
         sysfs_remove_group(sys_obj, &attr_group);
         kobject_put(sys_obj);
         sys_obj = NULL;
     }
+
+    // Espera um comando em andamento terminar antes de liberar os buffers
+    mutex_lock(&usb_lock);
+    smartlamp_device = NULL;
+    usb_free_urb(usb_rx_urb);
+    usb_rx_urb = NULL;
     kfree(usb_in_buffer);
     kfree(usb_out_buffer);
     usb_in_buffer = NULL;
     usb_out_buffer = NULL;
+    mutex_unlock(&usb_lock);
 }
 
-static long usb_send_cmd(const char *cmd, int param) {
-    char *clean_resp;
+// Envia um comando e espera a resposta chegar pelo usb_rx_complete. Chamado
+// com usb_lock travado. Se a resposta tiver carimbo, acerta o relógio e
+// devolve em *stamp_ns (se não for NULL) o momento da leitura do sensor no
+// relógio do host.
+static int usb_send_cmd_locked(const char *cmd, int param, long *value, s64 *stamp_ns) {
     int ret, actual_size;
-    int retries = 10;
-    static char response_buffer[MAX_RECV_LINE];
-    int total_received = 0;
-    long num;
+    unsigned long amostra, resposta;
+    s64 t0;
 
     if (!smartlamp_device)
         return -ENODEV;
 
+    ret = usb_rx_iniciar();
+    if (ret)
+        return ret;
+
     if (param >= 0)
         snprintf(usb_out_buffer, usb_max_size, "%s %d\n", cmd, param);
     else
         snprintf(usb_out_buffer, usb_max_size, "%s\n", cmd);
 
+    spin_lock_irq(&usb_rx_lock);
+    reinit_completion(&usb_resp_done);
+    usb_esperado = cmd;
+    usb_esperando = true;
+    spin_unlock_irq(&usb_rx_lock);
+
+    t0 = ktime_get_ns();
     ret = usb_bulk_msg(smartlamp_device,
                        usb_sndbulkpipe(smartlamp_device, usb_out),
                        usb_out_buffer, strlen(usb_out_buffer), &actual_size, 2000);
     if (ret) {
         printk(KERN_ERR "SmartLamp: Erro %d ao enviar comando '%s'\n", ret, cmd);
-        return ret;
+        goto out;
     }
 
-    memset(response_buffer, 0, sizeof(response_buffer));
-    total_received = 0;
+    if (!wait_for_completion_timeout(&usb_resp_done, msecs_to_jiffies(RESPONSE_TIMEOUT_MS))) {
+        printk(KERN_ERR "SmartLamp: Timeout na leitura da resposta\n");
+        ret = -ETIMEDOUT;
+        goto out;
+    }
+    if (usb_resp_line[0] == '\0') {
+        ret = -ENODEV;  // Desconectado durante a espera
+        goto out;
+    }
 
-    while (retries-- > 0) {
-        ret = usb_bulk_msg(smartlamp_device,
-                           usb_rcvbulkpipe(smartlamp_device, usb_in),
-                           usb_in_buffer, min(usb_max_size, MAX_RECV_LINE),
-                           &actual_size, 1500);
+    // O usb_rx_complete não escreve mais em usb_resp_line depois de completar
+    printk(KERN_INFO "SmartLamp: Resposta processada: [%s]\n", usb_resp_line);
+
+    if (separar_carimbo(usb_resp_line, &amostra, &resposta) == 0) {
+        relogio_amostra(&usb_relogio, resposta, t0, usb_resp_ns);
+        if (stamp_ns)
+            *stamp_ns = relogio_converter(&usb_relogio, amostra);
+    } else if (usb_carimbo == CARIMBO_ATIVO) {
+        // O ESP32 reiniciou e esqueceu o SET_STAMP; o micros() também zerou
+        usb_carimbo = CARIMBO_DESCONHECIDO;
+        usb_inteiros = false;
+        relogio_reiniciar(&usb_relogio);
+    }
 
-        if (ret) {
-            printk(KERN_ERR "SmartLamp: Erro ao ler dados (tentativa %d/10). Código: %d\n",
-                   (10 - retries), ret);
-            continue;
-        }
+    if (strncmp(usb_resp_line, "ERR", 3) == 0) {
+        ret = erro_da_resposta(usb_resp_line);
+        goto out;
+    }
 
-        if (total_received + actual_size < MAX_RECV_LINE) {
-            memcpy(response_buffer + total_received, usb_in_buffer, actual_size);
-            total_received += actual_size;
-            response_buffer[total_received] = '\0';
-        } else {
-            printk(KERN_ERR "SmartLamp: Buffer de resposta excedido!\n");
-            return -EOVERFLOW;
-        }
+    ret = extrair_ultimo_numero_kernel(usb_resp_line, value);
+    if (ret)
+        printk(KERN_ERR "SmartLamp: Formato de resposta inválido!\n");
+
+out:
+    spin_lock_irq(&usb_rx_lock);
+    usb_esperando = false;
+    spin_unlock_irq(&usb_rx_lock);
+    return ret;
+}
 
-        printk(KERN_INFO "SmartLamp: Resposta recebida: [%s]\n", response_buffer);
+// Liga os carimbos e o formato em escala fixa no firmware na primeira vez (e
+// depois de um reinício do ESP32). Firmware antigo responde ERR e segue sem
+// eles. Só um timeout é repassado, para não esperar por ele duas vezes no
+// mesmo comando.
+static int usb_ligar_carimbo_locked(void) {
+    long res;
+    int ret;
 
-        if (strchr(response_buffer, '\n') || strchr(response_buffer, '\r')) {
-            break;
-        }
+    if (usb_carimbo != CARIMBO_DESCONHECIDO)
+        return 0;
+
+    ret = usb_send_cmd_locked("SET_STAMP", 1, &res, NULL);
+    if (ret == -EOPNOTSUPP) {
+        printk(KERN_INFO "SmartLamp: Firmware sem carimbos de tempo\n");
+        usb_carimbo = CARIMBO_SEM_SUPORTE;
+    } else if (ret == 0 && res == 1) {
+        usb_carimbo = CARIMBO_ATIVO;
     }
+    if (ret == -ETIMEDOUT)
+        return ret;
+
+    ret = usb_send_cmd_locked("SET_FORMAT", 1, &res, NULL);
+    if (ret == -EOPNOTSUPP)
+        printk(KERN_INFO "SmartLamp: Firmware sem formato em escala fixa\n");
+    usb_inteiros = ret == 0 && res == 1;
+    return ret == -ETIMEDOUT ? ret : 0;
+}
 
-    if (total_received > 0) {
-        clean_resp = strim(response_buffer);
-        printk(KERN_INFO "SmartLamp: Resposta processada: [%s]\n", clean_resp);
+static int usb_send_cmd(const char *cmd, int param, long *value, s64 *stamp_ns) {
+    int ret;
 
-        num = extrair_ultimo_numero_kernel(clean_resp);
-        if (num != -EINVAL)
-            return num;
+    if (mutex_lock_interruptible(&usb_lock))
+        return -ERESTARTSYS;
+    ret = smartlamp_device ? usb_ligar_carimbo_locked() : 0;
+    if (ret == 0)
+        ret = usb_send_cmd_locked(cmd, param, value, stamp_ns);
+    mutex_unlock(&usb_lock);
+    return ret;
+}
 
+// LED ou LDR: o último valor da assinatura, se houver uma recente, ou o
+// resultado do comando cmd
+static int usb_get_assinado(int fonte, const char *cmd, long *value, s64 *stamp_ns) {
+    int ret;
+
+    if (mutex_lock_interruptible(&usb_lock))
+        return -ERESTARTSYS;
+
+    if (smartlamp_device && usb_assinatura_fresca(fonte)) {
+        *value = usb_assinatura[fonte].valor;
+        *stamp_ns = usb_assinatura[fonte].amostra_ns;
+        ret = 0;
+    } else {
+        ret = smartlamp_device ? usb_ligar_carimbo_locked() : -ENODEV;
+        if (ret == 0)
+            ret = usb_send_cmd_locked(cmd, -1, value, stamp_ns);
+    }
+
+    mutex_unlock(&usb_lock);
+    return ret;
+}
+
+// Lê temperatura, umidade e índice de calor com um GET_DHT, ou usa os do
+// cache se ainda forem recentes. Chamado com usb_lock travado.
+static int usb_ler_dht_locked(void) {
+    long valores[4], ok;
+    s64 stamp_ns = 0;
+    int ret;
+
+    if (usb_assinatura_fresca(ASSINA_DHT))
+        return 0;
+    if (usb_dht.valido && time_before(jiffies, usb_dht.lido_em + msecs_to_jiffies(DHT_CACHE_MS)))
+        return 0;
+
+    ret = usb_send_cmd_locked("GET_DHT", -1, &ok, &stamp_ns);
+    if (ret == -EOPNOTSUPP) {
+        printk(KERN_INFO "SmartLamp: Firmware sem GET_DHT, usando GET_TEMP/GET_HUM\n");
+        usb_dht.sem_suporte = true;
+    }
+    if (ret)
+        return ret;
+
+    // "RES GET_DHT <temp> <hum> <indice> <ok>". Se o ESP32 reiniciou, o
+    // usb_send_cmd_locked já desligou usb_inteiros e a resposta é lida como texto.
+    if (extrair_dht_kernel(usb_resp_line, usb_inteiros, valores)) {
         printk(KERN_ERR "SmartLamp: Formato de resposta inválido!\n");
         return -EINVAL;
     }
+    if (!valores[3])
+        printk(KERN_INFO "SmartLamp: Última leitura do DHT falhou, usando a anterior\n");
+
+    usb_dht.valido = true;
+    usb_dht.lido_em = jiffies;
+    usb_dht.temp = valores[0];
+    usb_dht.hum = valores[1];
+    usb_dht.indice = valores[2];
+    usb_dht.amostra_ns = stamp_ns;
+    return 0;
+}
 
-    printk(KERN_ERR "SmartLamp: Timeout na leitura da resposta\n");
-    return -ETIMEDOUT;
+// Valor de um sensor do DHT (temp, hum ou o índice de calor se sensor < 0)
+static int usb_get_dht(int sensor, long *value, s64 *stamp_ns) {
+    int ret;
+
+    if (mutex_lock_interruptible(&usb_lock))
+        return -ERESTARTSYS;
+
+    ret = smartlamp_device ? usb_ligar_carimbo_locked() : -ENODEV;
+    if (ret == 0 && usb_dht.sem_suporte) {
+        if (sensor == SENSOR_TEMP)
+            ret = usb_send_cmd_locked("GET_TEMP", -1, value, stamp_ns);
+        else if (sensor == SENSOR_HUM)
+            ret = usb_send_cmd_locked("GET_HUM", -1, value, stamp_ns);
+        else
+            ret = -EOPNOTSUPP;
+    } else if (ret == 0) {
+        ret = usb_ler_dht_locked();
+        if (ret == 0) {
+            *value = sensor == SENSOR_TEMP ? usb_dht.temp :
+                     sensor == SENSOR_HUM ? usb_dht.hum : usb_dht.indice;
+            *stamp_ns = usb_dht.amostra_ns;
+        }
+    }
+
+    mutex_unlock(&usb_lock);
+    return ret;
 }
 
 static ssize_t attr_show(struct kobject *sys_obj, struct kobj_attribute *attr, char *buff) {
-    long value = -1;
+    long value;
+    s64 stamp_ns = 0;
     const char *attr_name = attr->attr.name;
-    long aval;
+    int sensor, ret;
 
     printk(KERN_INFO "SmartLamp: Lendo %s ...\n", attr_name);
 
-    if (strcmp(attr_name, "led") == 0)
-        value = usb_send_cmd("GET_LED", -1);
-    else if (strcmp(attr_name, "ldr") == 0)
-        value = usb_send_cmd("GET_LDR", -1);
-    else if (strcmp(attr_name, "temp") == 0)
-        value = usb_send_cmd("GET_TEMP", -1);
-    else if (strcmp(attr_name, "hum") == 0)
-        value = usb_send_cmd("GET_HUM", -1);
-    
-
-    if (value < 0)
+    if (strcmp(attr_name, "led") == 0) {
+        sensor = SENSOR_LED;
+        ret = usb_get_assinado(ASSINA_LED, "GET_LED", &value, &stamp_ns);
+    } else if (strcmp(attr_name, "ldr") == 0) {
+        sensor = SENSOR_LDR;
+        ret = usb_get_assinado(ASSINA_LDR, "GET_LDR", &value, &stamp_ns);
+    } else if (strcmp(attr_name, "temp") == 0) {
+        sensor = SENSOR_TEMP;
+        ret = usb_get_dht(sensor, &value, &stamp_ns);
+    } else if (strcmp(attr_name, "hum") == 0) {
+        sensor = SENSOR_HUM;
+        ret = usb_get_dht(sensor, &value, &stamp_ns);
+    } else if (strcmp(attr_name, "heat_index") == 0) {
+        sensor = -1;
+        ret = usb_get_dht(sensor, &value, &stamp_ns);
+    } else {
+        return -EINVAL;
+    }
+
+    if (ret < 0)
         return -EIO;
 
-    if (value % 1000 == 0)
-        return sprintf(buff, "%ld\n", value/1000);
-    else {
-        aval = value;
-        if (aval < 0) {
-            aval = -aval;
-            return sprintf(buff, "-%ld.%03ld\n", value/1000, aval%1000);
-        } else {
-            return sprintf(buff, "%ld.%03ld\n", value/1000, value%1000);
-        }
-    }
+    if (sensor >= 0)
+        WRITE_ONCE(usb_amostra_ns[sensor], stamp_ns);
+    return formatar_milesimos(buff, PAGE_SIZE, value);
+}
+
+// Momento (ktime_get_ns, CLOCK_MONOTONIC) em que o ESP32 leu o último valor
+// entregue de cada sensor: "led ldr temp hum". 0 quando não há carimbo.
+static ssize_t stamps_show(struct kobject *sys_obj, struct kobj_attribute *attr, char *buff) {
+    return sysfs_emit(buff, "%lld %lld %lld %lld\n",
+                      READ_ONCE(usb_amostra_ns[SENSOR_LED]), READ_ONCE(usb_amostra_ns[SENSOR_LDR]),
+                      READ_ONCE(usb_amostra_ns[SENSOR_TEMP]), READ_ONCE(usb_amostra_ns[SENSOR_HUM]));
+}
+
+// Estado da estimativa do relógio: "sincronizado deslocamento_ns deriva_ppb
+// rtt_min_ns amostras". O deslocamento é o tempo do host quando o micros()
+// do ESP32 valia zero no desdobramento atual, sem contar a deriva.
+static ssize_t clock_show(struct kobject *sys_obj, struct kobj_attribute *attr, char *buff) {
+    struct smartlamp_relogio r;
+
+    if (mutex_lock_interruptible(&usb_lock))
+        return -ERESTARTSYS;
+    r = usb_relogio;
+    mutex_unlock(&usb_lock);
+
+    return sysfs_emit(buff, "%d %lld %lld %lld %u\n", r.sincronizado,
+                      r.sincronizado ? r.ref_ns - r.ref_us * 1000 : 0LL,
+                      r.deriva_ppb, r.rtt_min_ns, r.amostras);
 }
 
 static ssize_t attr_store(struct kobject *sys_obj, struct kobj_attribute *attr, const char *buff, size_t count) {
-    long value;
+    long value, res;
     const char *attr_name = attr->attr.name;
 
     if (kstrtol(buff, 10, &value)) {
@@ -328,9 +863,78 @@ static ssize_t attr_store(struct kobject *sys_obj, struct kobj_attribute *attr,
     printk(KERN_INFO "SmartLamp: Setando %s para %ld ...\n", attr_name, value);
 
     if (strcmp(attr_name, "led") == 0) {
-        if (usb_send_cmd("SET_LED", value) < 0)
+        // O firmware responde "RES SET_LED 1" em caso de sucesso e -1 se o valor for inválido
+        if (usb_send_cmd("SET_LED", value, &res, NULL) < 0 || res < 0)
             return -EIO;
+
+        // O valor assinado fica velho até a próxima amostra
+        mutex_lock(&usb_lock);
+        usb_assinatura[ASSINA_LED].valido = false;
+        mutex_unlock(&usb_lock);
+    }
+
+    return count;
+}
+
+// Períodos das assinaturas em ms, "led ldr dht" (0 = sem assinatura)
+static ssize_t subscribe_show(struct kobject *sys_obj, struct kobj_attribute *attr, char *buff) {
+    return sysfs_emit(buff, "%u %u %u\n", READ_ONCE(usb_assinatura[ASSINA_LED].periodo_ms),
+                      READ_ONCE(usb_assinatura[ASSINA_LDR].periodo_ms),
+                      READ_ONCE(usb_assinatura[ASSINA_DHT].periodo_ms));
+}
+
+// "<led|ldr|dht> <periodo_ms>": pede ao firmware para enviar o sensor a cada
+// período (0 cancela). Com mais quatro campos, "<abs> <pct> <min_ms> <max_ms>",
+// configura antes o relato por mudança (SET_REPORT): só envia leituras que
+// andaram abs (décimos da unidade) ou pct % desde o último envio, com pelo
+// menos min_ms e no máximo max_ms entre envios; abs e pct zerados voltam a
+// enviar todas. Firmware sem SUBSCRIBE ou SET_REPORT devolve EOPNOTSUPP.
+static ssize_t subscribe_store(struct kobject *sys_obj, struct kobj_attribute *attr, const char *buff, size_t count) {
+    char nome[8], cmd[48];
+    unsigned int periodo, limiar_abs = 0, limiar_pct = 0, minimo = 0, maximo = 0;
+    long res = -1;
+    int fonte, ret, campos;
+
+    campos = sscanf(buff, "%7s %u %u %u %u %u", nome, &periodo, &limiar_abs, &limiar_pct, &minimo, &maximo);
+    if ((campos != 2 && campos != 6) || periodo > ASSINATURA_MAX_MS || limiar_abs > ASSINATURA_MAX_ABS ||
+        limiar_pct > 100 || minimo > ASSINATURA_MAX_MS || maximo > ASSINATURA_MAX_MS)
+        return -EINVAL;
+    for (fonte = 0; fonte < NUM_ASSINATURAS; fonte++)
+        if (strcasecmp(nome, nomes_assinatura[fonte]) == 0)
+            break;
+    if (fonte == NUM_ASSINATURAS)
+        return -EINVAL;
+
+    if (mutex_lock_interruptible(&usb_lock))
+        return -ERESTARTSYS;
+    ret = smartlamp_device ? usb_ligar_carimbo_locked() : -ENODEV;
+    if (ret == 0 && campos == 6) {
+        printk(KERN_INFO "SmartLamp: Relato de %s por mudança: %u/10, %u%%, %u a %u ms ...\n",
+               nomes_assinatura[fonte], limiar_abs, limiar_pct, minimo, maximo);
+        snprintf(cmd, sizeof(cmd), "SET_REPORT %s %u %u %u", nomes_assinatura[fonte],
+                 limiar_abs, limiar_pct, minimo);
+        ret = usb_send_cmd_locked(cmd, maximo, &res, NULL);
+        if (ret == 0 && res == 1) {
+            usb_assinatura[fonte].relato = limiar_abs || limiar_pct;
+            usb_assinatura[fonte].maximo_ms = maximo;
+        }
+        if (ret == 0 && res != 1)
+            ret = -EIO;
+    }
+    if (ret == 0) {
+        printk(KERN_INFO "SmartLamp: Assinando %s a cada %u ms ...\n", nomes_assinatura[fonte], periodo);
+        snprintf(cmd, sizeof(cmd), "SUBSCRIBE %s", nomes_assinatura[fonte]);
+        ret = usb_send_cmd_locked(cmd, periodo, &res, NULL);
+    }
+    if (ret == 0 && res == 1) {
+        usb_assinatura[fonte].periodo_ms = periodo;
+        usb_assinatura[fonte].valido = false;
     }
+    mutex_unlock(&usb_lock);
 
+    if (ret == -EOPNOTSUPP)
+        return ret;
+    if (ret < 0 || res != 1)
+        return -EIO;
     return count;
 }
@@ -0,0 +1,147 @@
+#ifndef SMARTLAMP_CLOCK_H
+#define SMARTLAMP_CLOCK_H
+
+// Estimativa do relógio do ESP32 em relação ao relógio do host.
+//
+// Com os carimbos ligados (SET_STAMP 1), cada resposta do firmware termina em
+// " @<amostra>,<resposta>": o micros() do momento em que o sensor foi lido e o
+// do momento em que a resposta foi montada. O segundo está sempre entre o
+// envio do comando (t0) e a chegada da resposta (t1) no host, então cada
+// comando dá um par (micros, t0..t1) para acertar o relógio; o primeiro é
+// convertido para o tempo do host com a estimativa resultante.
+//
+// A estimativa é uma reta host_ns = ref_ns + (us - ref_us) * (1000 + deriva):
+//   - só entram pares com ida e volta perto da menor já vista, porque nos
+//     outros o atraso (fila, retransmissão) domina o erro;
+//   - a fase é corrigida aos poucos a cada par bom, e a deriva a cada
+//     JANELA_DERIVA_US de relógio do ESP32;
+//   - um erro maior que SALTO_MAX_NS (ESP32 reiniciado, micros() voltou) refaz
+//     a referência do zero.
+// Tudo em inteiros de 64 bits, sem ponto flutuante, para rodar no kernel.
+// Como o smartlamp_parse.h, compila também em userspace.
+
+#ifdef __KERNEL__
+#include <linux/math64.h>
+#include <linux/types.h>
+#else
+#include <stdint.h>
+#endif
+
+#define RELOGIO_JANELA_DERIVA_US 10000000LL  // 10 s entre correções de deriva
+#define RELOGIO_SALTO_MAX_NS     20000000LL  // 20 ms
+#define RELOGIO_DERIVA_MAX_PPB   500000LL    // Cristal do ESP32: bem menos que 500 ppm
+#define RELOGIO_FOLGA_RTT_NS     200000LL    // Tolerância sobre a menor ida e volta
+
+struct smartlamp_relogio {
+    int sincronizado;
+    uint32_t amostras;       // Pares usados na estimativa
+    uint32_t ultimo_bruto;   // Último micros() de resposta, como veio (32 bits)
+    int64_t ultimo_us;       // O mesmo, desdobrado para 64 bits
+    int64_t ref_us;          // Ponto de referência da reta
+    int64_t ref_ns;
+    int64_t deriva_ppb;      // Quanto o ESP32 atrasa (+) ou adianta (-) em ppb
+    int64_t rtt_min_ns;      // Menor ida e volta recente
+};
+
+static inline int64_t relogio_div(int64_t a, int64_t b)
+{
+#ifdef __KERNEL__
+    return div64_s64(a, b);
+#else
+    return a / b;
+#endif
+}
+
+static inline void relogio_reiniciar(struct smartlamp_relogio *r)
+{
+    r->sincronizado = 0;
+    r->amostras = 0;
+    r->deriva_ppb = 0;
+}
+
+// micros() do ESP32 tem 32 bits e volta a zero a cada ~71 min. Desdobra um
+// valor próximo (menos de ~35 min de distância) do último carimbo de resposta.
+static inline int64_t relogio_desdobrar(const struct smartlamp_relogio *r, uint32_t bruto)
+{
+    return r->ultimo_us + (int32_t)(bruto - r->ultimo_bruto);
+}
+
+// Converte um micros() do ESP32 para nanossegundos do relógio do host.
+// Retorna 0 se ainda não há estimativa.
+static inline int64_t relogio_converter(const struct smartlamp_relogio *r, uint32_t bruto)
+{
+    int64_t d;
+
+    if (!r->sincronizado)
+        return 0;
+    d = relogio_desdobrar(r, bruto) - r->ref_us;
+    return r->ref_ns + d * 1000 + relogio_div(d * r->deriva_ppb, 1000000);
+}
+
+// Acompanha um micros() de resposta que não veio de um comando (amostra
+// enviada por assinatura): não há t0/t1 para corrigir a estimativa, mas o
+// desdobramento continua valendo mesmo sem comandos por mais de ~35 min
+static inline void relogio_acompanhar(struct smartlamp_relogio *r, uint32_t bruto)
+{
+    if (!r->sincronizado)
+        return;
+    r->ultimo_us = relogio_desdobrar(r, bruto);
+    r->ultimo_bruto = bruto;
+}
+
+// Registra um par: o ESP32 marcou 'bruto' enquanto o host esperava em [t0, t1]
+static inline void relogio_amostra(struct smartlamp_relogio *r, uint32_t bruto,
+                                   int64_t t0_ns, int64_t t1_ns)
+{
+    int64_t rtt = t1_ns - t0_ns;
+    int64_t meio = t0_ns + rtt / 2;
+    int64_t us, previsto, erro, dt;
+
+    if (!r->sincronizado) {
+        r->sincronizado = 1;
+        r->amostras = 1;
+        r->ultimo_bruto = bruto;
+        r->ultimo_us = 0;
+        r->ref_us = 0;
+        r->ref_ns = meio;
+        r->deriva_ppb = 0;
+        r->rtt_min_ns = rtt;
+        return;
+    }
+
+    us = relogio_desdobrar(r, bruto);
+    r->ultimo_bruto = bruto;
+    r->ultimo_us = us;
+
+    // A menor ida e volta cresce devagar para acompanhar mudanças no caminho
+    r->rtt_min_ns += r->rtt_min_ns / 64;
+    if (rtt < r->rtt_min_ns)
+        r->rtt_min_ns = rtt;
+    if (rtt > 2 * r->rtt_min_ns + RELOGIO_FOLGA_RTT_NS)
+        return;
+
+    previsto = relogio_converter(r, bruto);
+    erro = meio - previsto;
+    if (erro > RELOGIO_SALTO_MAX_NS || erro < -RELOGIO_SALTO_MAX_NS) {
+        relogio_reiniciar(r);
+        relogio_amostra(r, bruto, t0_ns, t1_ns);
+        return;
+    }
+
+    r->amostras++;
+    dt = us - r->ref_us;
+    if (dt >= RELOGIO_JANELA_DERIVA_US) {
+        // erro ns acumulados em dt us = erro * 10^6 / dt ppb; metade por vez
+        r->deriva_ppb += relogio_div(erro * 1000000, dt) / 2;
+        if (r->deriva_ppb > RELOGIO_DERIVA_MAX_PPB)
+            r->deriva_ppb = RELOGIO_DERIVA_MAX_PPB;
+        if (r->deriva_ppb < -RELOGIO_DERIVA_MAX_PPB)
+            r->deriva_ppb = -RELOGIO_DERIVA_MAX_PPB;
+        r->ref_us = us;
+        r->ref_ns = previsto + erro / 4;
+    } else {
+        r->ref_ns += erro / 4;
+    }
+}
+
+#endif
@@ -0,0 +1,358 @@
+#ifndef SMARTLAMP_PARSE_H
+#define SMARTLAMP_PARSE_H
+
+// Parser das respostas do firmware do SmartLamp ("RES GET_LDR 57",
+// "RES GET DHT 23.5", ...). Fica em um header separado e sem dependências do
+// kernel além de <linux/ctype.h> e <linux/string.h> para poder ser compilado
+// também em userspace (ferramentas e bibliotecas do host).
+
+#ifdef __KERNEL__
+#include <linux/ctype.h>
+#include <linux/errno.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#else
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#endif
+
+#define MAX_NUM_STR_SIZE 32
+
+// Extrai último número (int ou float) como string. Um número começa com
+// sinal ou dígito e precisa conter pelo menos um dígito, assim um '-' ou '+'
+// solto no fim da linha não esconde o valor anterior.
+static inline int extrair_ultimo_numero_str(const char *str, char *num_str, size_t sz)
+{
+    const char *p = str;
+    const char *ultimo_ini = NULL;
+    const char *ultimo_fim = NULL;
+
+    if (sz == 0)
+        return -EINVAL;
+
+    while (*p) {
+        if (*p == '+' || *p == '-' || isdigit((unsigned char)*p)) {
+            const char *start = p;
+            int digitos = isdigit((unsigned char)*p);
+
+            p++;
+            while (*p && (isdigit((unsigned char)*p) || *p == '.')) {
+                if (*p != '.')
+                    digitos = 1;
+                p++;
+            }
+            if (digitos) {
+                ultimo_ini = start;
+                ultimo_fim = p;
+            }
+        } else {
+            p++;
+        }
+    }
+    if (ultimo_ini && ultimo_fim) {
+        size_t len = ultimo_fim - ultimo_ini;
+        if (len >= sz)
+            return -ERANGE;
+        memcpy(num_str, ultimo_ini, len);
+        num_str[len] = '\0';
+        return 0;
+    }
+    num_str[0] = '\0';
+    return -EINVAL;
+}
+
+// Converte "[+-]123[.456]" para milésimos (23.5 -> 23500, 57 -> 57000).
+// Casas decimais além da terceira são truncadas.
+static inline int converter_milesimos(const char *num_str, long *valor)
+{
+    const char *p = num_str;
+    long inteiro = 0, mil = 0;
+    int negativo = 0, digitos = 0, casas = 0;
+
+    if (*p == '+' || *p == '-') {
+        negativo = (*p == '-');
+        p++;
+    }
+
+    for (; isdigit((unsigned char)*p); p++, digitos++) {
+        if (inteiro > (LONG_MAX / 1000 - 10) / 10)
+            return -ERANGE;
+        inteiro = inteiro * 10 + (*p - '0');
+    }
+
+    if (*p == '.') {
+        for (p++; isdigit((unsigned char)*p); p++, digitos++) {
+            if (casas < 3) {
+                mil = mil * 10 + (*p - '0');
+                casas++;
+            }
+        }
+    }
+
+    if (*p != '\0' || digitos == 0)
+        return -EINVAL;
+
+    while (casas < 3) {
+        mil *= 10;
+        casas++;
+    }
+
+    *valor = negativo ? -(inteiro * 1000 + mil) : inteiro * 1000 + mil;
+    return 0;
+}
+
+// Extrai último número da resposta e devolve em milésimos em *valor.
+// Retorna 0 ou um código de erro negativo; o valor em si pode ser negativo
+// (temperaturas abaixo de zero), por isso não é misturado com o status.
+static inline int extrair_ultimo_numero_kernel(const char *str, long *valor)
+{
+    char num_str[MAX_NUM_STR_SIZE];
+    int ret;
+
+    ret = extrair_ultimo_numero_str(str, num_str, sizeof(num_str));
+    if (ret < 0)
+        return ret;
+
+    return converter_milesimos(num_str, valor);
+}
+
+// Extrai todos os números separados por espaço da resposta, em ordem, como
+// milésimos ("RES GET_DHT 23.5 55.0 23.9 1" -> 23500 55000 23900 1000).
+// Palavras que não são números são puladas. Retorna quantos números foram
+// guardados em valores[0..max).
+static inline int extrair_numeros_kernel(const char *str, long *valores, int max)
+{
+    char num_str[MAX_NUM_STR_SIZE];
+    int n = 0;
+
+    while (*str) {
+        const char *ini;
+        size_t len;
+
+        while (*str == ' ')
+            str++;
+        ini = str;
+        while (*str && *str != ' ')
+            str++;
+        len = str - ini;
+        if (len == 0)
+            break;
+        if (len >= sizeof(num_str))
+            continue;
+
+        memcpy(num_str, ini, len);
+        num_str[len] = '\0';
+        if (converter_milesimos(num_str, &valores[n]) == 0 && ++n == max)
+            break;
+    }
+    return n;
+}
+
+// Extrai os inteiros separados por espaço da resposta, em ordem e sem
+// conversão ("RES GET_DHT 2350 553 2391 1" -> 2350 553 2391 1). Palavras que
+// não são inteiros, inclusive números com casas decimais, são puladas.
+// Retorna quantos inteiros foram guardados em valores[0..max).
+static inline int extrair_inteiros_kernel(const char *str, long *valores, int max)
+{
+    int n = 0;
+
+    while (*str && n < max) {
+        const char *p;
+        long v = 0;
+        int negativo;
+
+        while (*str == ' ')
+            str++;
+        p = str;
+        negativo = (*p == '-');
+        if (*p == '-' || *p == '+')
+            p++;
+        if (!isdigit((unsigned char)*p)) {
+            while (*str && *str != ' ')
+                str++;
+            continue;
+        }
+        for (; isdigit((unsigned char)*p); p++) {
+            if (v > (LONG_MAX - 9) / 10)
+                break;
+            v = v * 10 + (*p - '0');
+        }
+        if (*p == '\0' || *p == ' ')
+            valores[n++] = negativo ? -v : v;
+        while (*p && *p != ' ')
+            p++;
+        str = p;
+    }
+    return n;
+}
+
+// Temperatura, umidade, índice de calor e ok do GET_DHT (ou EVT DHT) em
+// milésimos, no formato pedido com SET_FORMAT: inteiros em escala fixa
+// (centésimos de °C e décimos de %) se inteiros, texto decimal senão.
+// Retorna 0, -EINVAL se a linha não tem os quatro valores, ou -ERANGE se um
+// inteiro não cabe em milésimos.
+static inline int extrair_dht_kernel(const char *str, int inteiros, long valores[4])
+{
+    int i;
+
+    if (!inteiros)
+        return extrair_numeros_kernel(str, valores, 4) == 4 ? 0 : -EINVAL;
+
+    if (extrair_inteiros_kernel(str, valores, 4) != 4)
+        return -EINVAL;
+    for (i = 0; i < 4; i++) {
+        if (valores[i] > LONG_MAX / 1000 || valores[i] < -(LONG_MAX / 1000))
+            return -ERANGE;
+    }
+    valores[0] *= 10;
+    valores[1] *= 100;
+    valores[2] *= 10;
+    valores[3] *= 1000;
+    return 0;
+}
+
+// Lê um número decimal sem sinal de até 32 bits em *p, avançando *p
+static inline int ler_u32(const char **p, unsigned long *valor)
+{
+    unsigned long long v = 0;
+    const char *s = *p;
+
+    if (!isdigit((unsigned char)*s))
+        return -EINVAL;
+    for (; isdigit((unsigned char)*s); s++) {
+        v = v * 10 + (*s - '0');
+        if (v > 0xffffffffULL)
+            return -ERANGE;
+    }
+    *p = s;
+    *valor = v;
+    return 0;
+}
+
+// Separa o carimbo de tempo " @<amostra>,<resposta>" (micros() do ESP32) do
+// fim de uma resposta, cortando a linha antes dele para que o valor continue
+// sendo o último número. Retorna 0, ou -ENOENT se a linha não tem carimbo.
+static inline int separar_carimbo(char *line, unsigned long *amostra, unsigned long *resposta)
+{
+    char *arroba = strrchr(line, '@');
+    const char *p;
+
+    if (!arroba || arroba == line || arroba[-1] != ' ')
+        return -ENOENT;
+
+    p = arroba + 1;
+    if (ler_u32(&p, amostra) || *p++ != ',' || ler_u32(&p, resposta) || *p != '\0')
+        return -ENOENT;
+
+    arroba[-1] = '\0';
+    return 0;
+}
+
+// Diz se line[0..len) é uma resposta do firmware ("RES ..." ou "ERR ...") e
+// não o eco do comando, que o firmware repete antes de responder
+static inline int linha_eh_resposta(const char *line, size_t len)
+{
+    return len >= 3 && (strncmp(line, "RES", 3) == 0 || strncmp(line, "ERR", 3) == 0);
+}
+
+// Tamanho da palavra no início de p[0..n), até um espaço ou um ponto
+static inline size_t tamanho_palavra(const char *p, size_t n)
+{
+    size_t i = 0;
+
+    while (i < n && p[i] != ' ' && p[i] != '.')
+        i++;
+    return i;
+}
+
+// Diz se a palavra p[0..n) é igual à primeira palavra de s
+static inline int palavra_igual(const char *p, size_t n, const char *s)
+{
+    return n == strcspn(s, " ") && strncmp(p, s, n) == 0;
+}
+
+// Diz se a resposta line[0..len) é do comando cmd (só a primeira palavra de
+// cmd conta): "RES <cmd> ..." ou um ERR desse comando. Depois de um timeout
+// a resposta atrasada ainda pode chegar, e não pode completar o comando
+// seguinte. O GET_TEMP e o GET_HUM respondem "RES GET DHT <valor>", e os
+// erros de sensor dizem o sensor ("ERR SENSOR TEMP."). Os demais ERR
+// ("Unknown command.", "Line too long.") não dizem o comando, mas saem na
+// hora, sem esperar o sensor, então valem para o comando pendente.
+static inline int resposta_do_comando(const char *line, size_t len, const char *cmd)
+{
+    const char *p = line + 4;
+    size_t resto, n;
+
+    if (len < 4 || line[3] != ' ')
+        return 0;
+    resto = len - 4;
+    n = tamanho_palavra(p, resto);
+
+    if (strncmp(line, "RES", 3) == 0) {
+        if (palavra_igual(p, n, cmd))
+            return 1;
+        return palavra_igual(p, n, "GET") && resto > 8 && strncmp(p + 3, " DHT ", 5) == 0 &&
+               (palavra_igual("GET_TEMP", 8, cmd) || palavra_igual("GET_HUM", 7, cmd));
+    }
+
+    if (!palavra_igual(p, n, "SENSOR"))
+        return 1;
+    if (n + 1 >= resto || strncmp(cmd, "GET_", 4) != 0)
+        return 0;
+    p += n + 1;
+    resto -= n + 1;
+    return palavra_igual(p, tamanho_palavra(p, resto), cmd + 4);
+}
+
+// Diz se line[0..len) é uma amostra enviada por assinatura ("EVT LDR 57"),
+// que chega sem um comando pendente
+static inline int linha_eh_evento(const char *line, size_t len)
+{
+    return len >= 4 && strncmp(line, "EVT ", 4) == 0;
+}
+
+// Código de erro para uma linha "ERR ...": -EOPNOTSUPP quando o firmware não
+// conhece o comando (versão antiga), -EIO para os demais erros
+static inline int erro_da_resposta(const char *line)
+{
+    return strncmp(line, "ERR Unknown command", 19) == 0 ? -EOPNOTSUPP : -EIO;
+}
+
+// Procura em buf[0..len) a primeira linha completa que seja uma resposta do
+// firmware. Retorna 0 e a linha em [*ini, *fim), ou -EAGAIN se ainda não
+// chegou uma linha completa.
+static inline int encontrar_linha_resposta(const char *buf, size_t len,
+                                           size_t *ini, size_t *fim)
+{
+    size_t i, inicio = 0;
+
+    for (i = 0; i < len; i++) {
+        if (buf[i] != '\n' && buf[i] != '\r')
+            continue;
+        if (linha_eh_resposta(buf + inicio, i - inicio)) {
+            *ini = inicio;
+            *fim = i;
+            return 0;
+        }
+        inicio = i + 1;
+    }
+    return -EAGAIN;
+}
+
+// Escreve um valor em milésimos no formato decimal seguido de '\n'
+// (57000 -> "57", -1500 -> "-1.500"). Retorna o número de caracteres escritos.
+static inline int formatar_milesimos(char *buf, size_t sz, long value)
+{
+    const char *sinal = value < 0 ? "-" : "";
+    unsigned long aval = value < 0 ? -(unsigned long)value : (unsigned long)value;
+
+    if (aval % 1000 == 0)
+        return snprintf(buf, sz, "%s%lu\n", sinal, aval / 1000);
+    return snprintf(buf, sz, "%s%lu.%03lu\n", sinal, aval / 1000, aval % 1000);
+}
+
+#endif
@@ -0,0 +1,452 @@
+#include <linux/module.h>
+#include <linux/completion.h>
+#include <linux/jiffies.h>
+#include <linux/mod_devicetable.h>
+#include <linux/mutex.h>
+#include <linux/property.h>
+#include <linux/serdev.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/timekeeping.h>
+#include <linux/version.h>
+
+#include "smartlamp_clock.h"
+#include "smartlamp_parse.h"
+
+MODULE_AUTHOR("DevTITANS <devtitans@icomp.ufam.edu.br>");
+MODULE_DESCRIPTION("Driver de acesso ao SmartLamp via serdev (ESP32 em qualquer UART)");
+MODULE_LICENSE("GPL");
+
+// Variante do driver que fala o mesmo protocolo do smartlamp.c, mas como
+// cliente serdev: a configuração da UART fica com o driver da própria porta
+// e a recepção chega pelo callback receive_buf, sem laço de leitura.
+//
+// O serdev só se associa a UARTs descritas no devicetree/ACPI (UARTs da
+// placa). Exemplo de overlay para um ESP32 ligado na uart3:
+//
+//     &uart3 {
+//         status = "okay";
+//         smartlamp {
+//             compatible = "devtitans,smartlamp";
+//             current-speed = <115200>;
+//         };
+//     };
+//
+// Os arquivos ficam em /sys/bus/serial/devices/<serialN-0>/{led,ldr,temp,hum},
+// com stamps e clock como no smartlamp.c.
+
+#define MAX_RECV_LINE 100
+#define RESPONSE_TIMEOUT_MS 3000 // A leitura do DHT pode levar alguns ms
+
+enum { CARIMBO_DESCONHECIDO, CARIMBO_ATIVO, CARIMBO_SEM_SUPORTE };
+enum { SENSOR_LED, SENSOR_LDR, SENSOR_TEMP, SENSOR_HUM, NUM_SENSORES };
+
+#define DHT_CACHE_MS 1000 // Validade do resultado do GET_DHT (ver smartlamp.c)
+
+static uint baudrate = 115200; // Usado quando o devicetree não tem current-speed
+module_param(baudrate, uint, 0444);
+MODULE_PARM_DESC(baudrate, "Baud rate padrão da serial do ESP32 (padrão 115200)");
+
+struct smartlamp {
+    struct serdev_device *serdev;
+    struct mutex cmd_lock;              // Um comando por vez na linha serial
+    spinlock_t rx_lock;                 // Protege os campos abaixo contra o receive_buf
+    char rx_line[MAX_RECV_LINE];        // Linha sendo montada
+    size_t rx_len;
+    bool rx_overflow;                   // Linha atual passou de MAX_RECV_LINE
+    char resp_line[MAX_RECV_LINE];      // Última resposta entregue ao comando
+    bool waiting;                       // Há um comando esperando resposta
+    const char *waiting_cmd;            // Comando que espera (se waiting)
+    s64 resp_ns;                        // Quando a resposta chegou
+    struct completion resp_done;
+
+    // Carimbos de tempo do firmware; protegidos por cmd_lock
+    int carimbo;
+    bool inteiros;                      // SET_FORMAT 1 aceito
+    struct smartlamp_relogio relogio;
+    s64 amostra_ns[NUM_SENSORES];
+
+    // Último GET_DHT; protegido por cmd_lock
+    struct {
+        bool valido;
+        bool sem_suporte;
+        unsigned long lido_em;
+        long temp, hum, indice;
+        s64 amostra_ns;
+    } dht;
+};
+
+static int smartlamp_send_cmd(struct smartlamp *lamp, const char *cmd, int param, long *value, s64 *stamp_ns);
+
+static ssize_t attr_show(struct device *dev, struct device_attribute *attr, char *buff);
+static ssize_t attr_store(struct device *dev, struct device_attribute *attr, const char *buff, size_t count);
+static ssize_t stamps_show(struct device *dev, struct device_attribute *attr, char *buff);
+static ssize_t clock_show(struct device *dev, struct device_attribute *attr, char *buff);
+
+static struct device_attribute led_attribute = __ATTR(led, S_IRUGO | S_IWUSR, attr_show, attr_store);
+static struct device_attribute ldr_attribute = __ATTR(ldr, S_IRUGO, attr_show, NULL);
+static struct device_attribute temp_attribute = __ATTR(temp, S_IRUGO, attr_show, NULL);
+static struct device_attribute hum_attribute = __ATTR(hum, S_IRUGO, attr_show, NULL);
+static struct device_attribute heat_index_attribute = __ATTR(heat_index, S_IRUGO, attr_show, NULL);
+static struct device_attribute stamps_attribute = __ATTR(stamps, S_IRUGO, stamps_show, NULL);
+static struct device_attribute clock_attribute = __ATTR(clock, S_IRUGO, clock_show, NULL);
+
+static struct attribute *smartlamp_attrs[] = { &led_attribute.attr, &ldr_attribute.attr, &temp_attribute.attr, &hum_attribute.attr,
+                                               &heat_index_attribute.attr, &stamps_attribute.attr, &clock_attribute.attr, NULL };
+ATTRIBUTE_GROUPS(smartlamp);
+
+// Executado pelo tty a cada bloco de bytes recebido na UART. Monta as linhas
+// e entrega a primeira resposta ("RES ..."/"ERR ...") ao comando pendente;
+// o eco do comando e linhas longas demais são descartados.
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 8, 0)
+static size_t smartlamp_receive_buf(struct serdev_device *serdev, const u8 *data, size_t count)
+#else
+static int smartlamp_receive_buf(struct serdev_device *serdev, const unsigned char *data, size_t count)
+#endif
+{
+    struct smartlamp *lamp = serdev_device_get_drvdata(serdev);
+    unsigned long flags;
+    size_t i;
+
+    spin_lock_irqsave(&lamp->rx_lock, flags);
+    for (i = 0; i < count; i++) {
+        char c = data[i];
+
+        if (c != '\n' && c != '\r') {
+            if (lamp->rx_len < sizeof(lamp->rx_line) - 1)
+                lamp->rx_line[lamp->rx_len++] = c;
+            else
+                lamp->rx_overflow = true;
+            continue;
+        }
+
+        if (lamp->waiting && !lamp->rx_overflow &&
+            linha_eh_resposta(lamp->rx_line, lamp->rx_len)) {
+            if (resposta_do_comando(lamp->rx_line, lamp->rx_len, lamp->waiting_cmd)) {
+                memcpy(lamp->resp_line, lamp->rx_line, lamp->rx_len);
+                lamp->resp_line[lamp->rx_len] = '\0';
+                lamp->resp_ns = ktime_get_ns();
+                lamp->waiting = false;
+                complete(&lamp->resp_done);
+            } else {
+                // Resposta atrasada de um comando que já deu timeout
+                printk(KERN_INFO "SmartLamp: Resposta fora de hora descartada: [%.*s]\n",
+                       (int)lamp->rx_len, lamp->rx_line);
+            }
+        }
+        lamp->rx_len = 0;
+        lamp->rx_overflow = false;
+    }
+    spin_unlock_irqrestore(&lamp->rx_lock, flags);
+
+    return count;
+}
+
+static const struct serdev_device_ops smartlamp_serdev_ops = {
+    .receive_buf  = smartlamp_receive_buf,
+    .write_wakeup = serdev_device_write_wakeup,
+};
+
+// Envia um comando e espera a resposta chegar pelo receive_buf. Chamado com
+// cmd_lock travado. Se a resposta tiver carimbo, acerta o relógio e devolve
+// em *stamp_ns (se não for NULL) o momento da leitura no relógio do host.
+static int smartlamp_send_cmd_locked(struct smartlamp *lamp, const char *cmd, int param,
+                                     long *value, s64 *stamp_ns)
+{
+    char line[MAX_RECV_LINE];
+    unsigned long flags, amostra, resposta;
+    int len, ret;
+    s64 t0;
+
+    if (param >= 0)
+        len = snprintf(line, sizeof(line), "%s %d\n", cmd, param);
+    else
+        len = snprintf(line, sizeof(line), "%s\n", cmd);
+
+    spin_lock_irqsave(&lamp->rx_lock, flags);
+    reinit_completion(&lamp->resp_done);
+    lamp->waiting_cmd = cmd;
+    lamp->waiting = true;
+    spin_unlock_irqrestore(&lamp->rx_lock, flags);
+
+    t0 = ktime_get_ns();
+    ret = serdev_device_write(lamp->serdev, (const unsigned char *)line, len,
+                              msecs_to_jiffies(RESPONSE_TIMEOUT_MS));
+    if (ret < 0) {
+        printk(KERN_ERR "SmartLamp: Erro %d ao enviar comando '%s'\n", ret, cmd);
+        goto out;
+    }
+
+    if (!wait_for_completion_timeout(&lamp->resp_done, msecs_to_jiffies(RESPONSE_TIMEOUT_MS))) {
+        printk(KERN_ERR "SmartLamp: Timeout na leitura da resposta\n");
+        ret = -ETIMEDOUT;
+        goto out;
+    }
+
+    // O receive_buf não escreve mais em resp_line depois de completar
+    printk(KERN_INFO "SmartLamp: Resposta processada: [%s]\n", lamp->resp_line);
+
+    if (separar_carimbo(lamp->resp_line, &amostra, &resposta) == 0) {
+        relogio_amostra(&lamp->relogio, resposta, t0, lamp->resp_ns);
+        if (stamp_ns)
+            *stamp_ns = relogio_converter(&lamp->relogio, amostra);
+    } else if (lamp->carimbo == CARIMBO_ATIVO) {
+        // O ESP32 reiniciou e esqueceu o SET_STAMP; o micros() também zerou
+        lamp->carimbo = CARIMBO_DESCONHECIDO;
+        lamp->inteiros = false;
+        relogio_reiniciar(&lamp->relogio);
+    }
+
+    if (strncmp(lamp->resp_line, "ERR", 3) == 0) {
+        ret = erro_da_resposta(lamp->resp_line);
+        goto out;
+    }
+
+    ret = extrair_ultimo_numero_kernel(lamp->resp_line, value);
+    if (ret)
+        printk(KERN_ERR "SmartLamp: Formato de resposta inválido!\n");
+
+out:
+    spin_lock_irqsave(&lamp->rx_lock, flags);
+    lamp->waiting = false;
+    spin_unlock_irqrestore(&lamp->rx_lock, flags);
+    return ret;
+}
+
+// Liga os carimbos e o formato em escala fixa no firmware na primeira vez (e
+// depois de um reinício do ESP32); firmware antigo responde ERR. Só um
+// timeout é repassado.
+static int smartlamp_ligar_carimbo_locked(struct smartlamp *lamp)
+{
+    long res;
+    int ret;
+
+    if (lamp->carimbo != CARIMBO_DESCONHECIDO)
+        return 0;
+
+    ret = smartlamp_send_cmd_locked(lamp, "SET_STAMP", 1, &res, NULL);
+    if (ret == -EOPNOTSUPP) {
+        printk(KERN_INFO "SmartLamp: Firmware sem carimbos de tempo\n");
+        lamp->carimbo = CARIMBO_SEM_SUPORTE;
+    } else if (ret == 0 && res == 1) {
+        lamp->carimbo = CARIMBO_ATIVO;
+    }
+    if (ret == -ETIMEDOUT)
+        return ret;
+
+    ret = smartlamp_send_cmd_locked(lamp, "SET_FORMAT", 1, &res, NULL);
+    if (ret == -EOPNOTSUPP)
+        printk(KERN_INFO "SmartLamp: Firmware sem formato em escala fixa\n");
+    lamp->inteiros = ret == 0 && res == 1;
+    return ret == -ETIMEDOUT ? ret : 0;
+}
+
+static int smartlamp_send_cmd(struct smartlamp *lamp, const char *cmd, int param, long *value, s64 *stamp_ns)
+{
+    int ret;
+
+    if (mutex_lock_interruptible(&lamp->cmd_lock))
+        return -ERESTARTSYS;
+    ret = smartlamp_ligar_carimbo_locked(lamp);
+    if (ret == 0)
+        ret = smartlamp_send_cmd_locked(lamp, cmd, param, value, stamp_ns);
+    mutex_unlock(&lamp->cmd_lock);
+    return ret;
+}
+
+// Lê temperatura, umidade e índice de calor com um GET_DHT, ou usa os do
+// cache se ainda forem recentes. Chamado com cmd_lock travado.
+static int smartlamp_ler_dht_locked(struct smartlamp *lamp)
+{
+    long valores[4], ok;
+    s64 stamp_ns = 0;
+    int ret;
+
+    if (lamp->dht.valido && time_before(jiffies, lamp->dht.lido_em + msecs_to_jiffies(DHT_CACHE_MS)))
+        return 0;
+
+    ret = smartlamp_send_cmd_locked(lamp, "GET_DHT", -1, &ok, &stamp_ns);
+    if (ret == -EOPNOTSUPP) {
+        printk(KERN_INFO "SmartLamp: Firmware sem GET_DHT, usando GET_TEMP/GET_HUM\n");
+        lamp->dht.sem_suporte = true;
+    }
+    if (ret)
+        return ret;
+
+    // "RES GET_DHT <temp> <hum> <indice> <ok>"; depois de um reinício do
+    // ESP32 inteiros já foi desligado e a resposta é lida como texto
+    if (extrair_dht_kernel(lamp->resp_line, lamp->inteiros, valores)) {
+        printk(KERN_ERR "SmartLamp: Formato de resposta inválido!\n");
+        return -EINVAL;
+    }
+    if (!valores[3])
+        printk(KERN_INFO "SmartLamp: Última leitura do DHT falhou, usando a anterior\n");
+
+    lamp->dht.valido = true;
+    lamp->dht.lido_em = jiffies;
+    lamp->dht.temp = valores[0];
+    lamp->dht.hum = valores[1];
+    lamp->dht.indice = valores[2];
+    lamp->dht.amostra_ns = stamp_ns;
+    return 0;
+}
+
+// Valor de um sensor do DHT (temp, hum ou o índice de calor se sensor < 0)
+static int smartlamp_get_dht(struct smartlamp *lamp, int sensor, long *value, s64 *stamp_ns)
+{
+    int ret;
+
+    if (mutex_lock_interruptible(&lamp->cmd_lock))
+        return -ERESTARTSYS;
+
+    ret = smartlamp_ligar_carimbo_locked(lamp);
+    if (ret == 0 && lamp->dht.sem_suporte) {
+        if (sensor == SENSOR_TEMP)
+            ret = smartlamp_send_cmd_locked(lamp, "GET_TEMP", -1, value, stamp_ns);
+        else if (sensor == SENSOR_HUM)
+            ret = smartlamp_send_cmd_locked(lamp, "GET_HUM", -1, value, stamp_ns);
+        else
+            ret = -EOPNOTSUPP;
+    } else if (ret == 0) {
+        ret = smartlamp_ler_dht_locked(lamp);
+        if (ret == 0) {
+            *value = sensor == SENSOR_TEMP ? lamp->dht.temp :
+                     sensor == SENSOR_HUM ? lamp->dht.hum : lamp->dht.indice;
+            *stamp_ns = lamp->dht.amostra_ns;
+        }
+    }
+
+    mutex_unlock(&lamp->cmd_lock);
+    return ret;
+}
+
+static ssize_t attr_show(struct device *dev, struct device_attribute *attr, char *buff)
+{
+    struct smartlamp *lamp = dev_get_drvdata(dev);
+    const char *attr_name = attr->attr.name;
+    long value;
+    s64 stamp_ns = 0;
+    int sensor, ret;
+
+    printk(KERN_INFO "SmartLamp: Lendo %s ...\n", attr_name);
+
+    if (strcmp(attr_name, "led") == 0) {
+        sensor = SENSOR_LED;
+        ret = smartlamp_send_cmd(lamp, "GET_LED", -1, &value, &stamp_ns);
+    } else if (strcmp(attr_name, "ldr") == 0) {
+        sensor = SENSOR_LDR;
+        ret = smartlamp_send_cmd(lamp, "GET_LDR", -1, &value, &stamp_ns);
+    } else if (strcmp(attr_name, "temp") == 0) {
+        sensor = SENSOR_TEMP;
+        ret = smartlamp_get_dht(lamp, sensor, &value, &stamp_ns);
+    } else if (strcmp(attr_name, "hum") == 0) {
+        sensor = SENSOR_HUM;
+        ret = smartlamp_get_dht(lamp, sensor, &value, &stamp_ns);
+    } else if (strcmp(attr_name, "heat_index") == 0) {
+        sensor = -1;
+        ret = smartlamp_get_dht(lamp, sensor, &value, &stamp_ns);
+    } else {
+        return -EINVAL;
+    }
+
+    if (ret < 0)
+        return -EIO;
+
+    if (sensor >= 0)
+        WRITE_ONCE(lamp->amostra_ns[sensor], stamp_ns);
+    return formatar_milesimos(buff, PAGE_SIZE, value);
+}
+
+static ssize_t stamps_show(struct device *dev, struct device_attribute *attr, char *buff)
+{
+    struct smartlamp *lamp = dev_get_drvdata(dev);
+
+    return sysfs_emit(buff, "%lld %lld %lld %lld\n",
+                      READ_ONCE(lamp->amostra_ns[SENSOR_LED]), READ_ONCE(lamp->amostra_ns[SENSOR_LDR]),
+                      READ_ONCE(lamp->amostra_ns[SENSOR_TEMP]), READ_ONCE(lamp->amostra_ns[SENSOR_HUM]));
+}
+
+static ssize_t clock_show(struct device *dev, struct device_attribute *attr, char *buff)
+{
+    struct smartlamp *lamp = dev_get_drvdata(dev);
+    struct smartlamp_relogio r;
+
+    if (mutex_lock_interruptible(&lamp->cmd_lock))
+        return -ERESTARTSYS;
+    r = lamp->relogio;
+    mutex_unlock(&lamp->cmd_lock);
+
+    return sysfs_emit(buff, "%d %lld %lld %lld %u\n", r.sincronizado,
+                      r.sincronizado ? r.ref_ns - r.ref_us * 1000 : 0LL,
+                      r.deriva_ppb, r.rtt_min_ns, r.amostras);
+}
+
+static ssize_t attr_store(struct device *dev, struct device_attribute *attr, const char *buff, size_t count)
+{
+    struct smartlamp *lamp = dev_get_drvdata(dev);
+    const char *attr_name = attr->attr.name;
+    long value, res;
+
+    if (kstrtol(buff, 10, &value) || value < 0 || value > 100) {
+        printk(KERN_ALERT "SmartLamp: valor de %s inválido.\n", attr_name);
+        return -EINVAL;
+    }
+
+    printk(KERN_INFO "SmartLamp: Setando %s para %ld ...\n", attr_name, value);
+
+    if (smartlamp_send_cmd(lamp, "SET_LED", value, &res, NULL) < 0 || res < 0)
+        return -EIO;
+
+    return count;
+}
+
+static int smartlamp_probe(struct serdev_device *serdev)
+{
+    struct device *dev = &serdev->dev;
+    struct smartlamp *lamp;
+    u32 speed = baudrate;
+    int ret;
+
+    lamp = devm_kzalloc(dev, sizeof(*lamp), GFP_KERNEL);
+    if (!lamp)
+        return -ENOMEM;
+
+    lamp->serdev = serdev;
+    mutex_init(&lamp->cmd_lock);
+    spin_lock_init(&lamp->rx_lock);
+    init_completion(&lamp->resp_done);
+
+    serdev_device_set_drvdata(serdev, lamp);
+    serdev_device_set_client_ops(serdev, &smartlamp_serdev_ops);
+
+    ret = devm_serdev_device_open(dev, serdev);
+    if (ret) {
+        printk(KERN_ERR "SmartLamp: Erro ao abrir a serial (código %d)\n", ret);
+        return ret;
+    }
+
+    device_property_read_u32(dev, "current-speed", &speed);
+    speed = serdev_device_set_baudrate(serdev, speed);
+    serdev_device_set_flow_control(serdev, false);
+
+    printk(KERN_INFO "SmartLamp: Conectado em %s a %u baud\n", dev_name(dev), speed);
+    return 0;
+}
+
+static const struct of_device_id smartlamp_of_match[] = {
+    { .compatible = "devtitans,smartlamp" },
+    {}
+};
+MODULE_DEVICE_TABLE(of, smartlamp_of_match);
+
+static struct serdev_device_driver smartlamp_serdev_driver = {
+    .probe = smartlamp_probe,
+    .driver = {
+        .name           = "smartlamp_serdev",
+        .of_match_table = smartlamp_of_match,
+        .dev_groups     = smartlamp_groups,
+    },
+};
+
+module_serdev_device_driver(smartlamp_serdev_driver);
@@ -21,6 +21,7 @@
 #define _ADAFRUIT_SENSOR_H
 
 #ifndef ARDUINO
+#include <stddef.h>
 #include <stdint.h>
 #elif ARDUINO >= 100
 #include "Arduino.h"
@@ -215,6 +216,17 @@ public:
   /*! @brief Get the latest sensor event
       @returns True if able to fetch an event */
   virtual bool getEvent(sensors_event_t *) = 0;
+
+  /*! @brief Get the latest events of every channel of the device, all from
+     the same acquisition. Devices that measure several quantities at once
+     override this; by default it is a single getEvent().
+      @param events Array of events to fill
+      @param count Number of events in the array
+      @returns Number of events filled */
+  virtual size_t getEvents(sensors_event_t *events, size_t count) {
+    return count > 0 && getEvent(events) ? 1 : 0;
+  }
+
   /*! @brief Get info about the sensor itself */
   virtual void getSensor(sensor_t *) = 0;
 
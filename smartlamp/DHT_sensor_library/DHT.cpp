@@ -26,6 +26,12 @@
 #include "DHT.h"
 
 #define MIN_INTERVAL 2000 /**< min interval value */
+/* Phases of a transaction started by startRead() */
+#define DHT_STATE_IDLE 0   /**< No transaction in progress */
+#define DHT_STATE_PULLUP 1 /**< Line released before the start signal */
+#define DHT_STATE_START 2  /**< Start signal: line held low */
+#define DHT_STATE_RMT 3    /**< Waiting for the RMT frame */
+#define DHT_STATE_RETRY 4  /**< Waiting out the interval before a retry */
 #define TIMEOUT                                                                \
   UINT32_MAX /**< Used programmatically for timeout.                           \
                    Not a timeout duration. Type: uint32_t. */
@@ -47,11 +53,20 @@ DHT::DHT(uint8_t pin, uint8_t type, uint8_t count) {
   _bit = digitalPinToBitMask(pin);
   _port = digitalPinToPort(pin);
 #endif
+  _lasterror = DHT_ERROR_NONE;
+  _state = DHT_STATE_IDLE;
+  _retries = 0;
+  _attempt = 0;
+  _stats = dht_stats_t();
   _maxcycles =
       microsecondsToClockCycles(1000); // 1 millisecond timeout for
                                        // reading pulses from DHT sensor.
   // Note that count is now ignored as the DHT reading algorithm adjusts itself
   // based on the speed of the processor.
+#ifdef DHT_USE_RMT
+  _rmtChannel = NULL;
+  _rmtQueue = NULL;
+#endif
 }
 
 /*!
@@ -67,9 +82,15 @@ void DHT::begin(uint8_t usec) {
   // >= MIN_INTERVAL right away. Note that this assignment wraps around,
   // but so will the subtraction.
   _lastreadtime = millis() - MIN_INTERVAL;
+  _lastreadmicros = micros();
   DEBUG_PRINT("DHT max clock cycles: ");
   DEBUG_PRINTLN(_maxcycles, DEC);
   pullTime = usec;
+#ifdef DHT_USE_RMT
+  if (!beginRmt()) {
+    DEBUG_PRINTLN(F("DHT RMT unavailable, using bit-banging."));
+  }
+#endif
 }
 
 /*!
@@ -221,24 +242,97 @@ float DHT::computeHeatIndex(float temperature, float percentHumidity,
   return isFahrenheit ? hi : convertFtoC(hi);
 }
 
+/*!
+ *  @brief  Time of the last actual sensor transaction, as returned by
+ *          micros(). Cached readings from read() keep the time of the
+ *          transaction they came from.
+ *	@return micros() value when the last reading was started
+ */
+uint32_t DHT::lastReadMicros() { return _lastreadmicros; }
+
+/*!
+ *  @brief  Why the last actual sensor transaction failed. Cached readings
+ *          from read() keep the error of the transaction they came from.
+ *	@return DHT_ERROR_NONE, DHT_ERROR_TIMEOUT or DHT_ERROR_CHECKSUM
+ */
+uint8_t DHT::lastError() { return _lasterror; }
+
+/*!
+ *  @brief  Retry failed transactions automatically. Each retry waits out the
+ *          sensor's minimum interval (1 s for the DHT11, 2 s for the others)
+ *          inside poll(), so a transaction with retries can stay busy for
+ *          several seconds; read() blocks for all of it. poll() reports
+ *          DHT_READ_DONE only for the last attempt.
+ *  @param  retries
+ *          attempts after the first one, 0 (the default) to never retry
+ */
+void DHT::setRetries(uint8_t retries) { _retries = retries; }
+
+/*!
+ *  @brief  Quality counters since the sensor was constructed
+ *  @return successes, retries, timeouts and checksum errors
+ */
+dht_stats_t DHT::stats() { return _stats; }
+
 /*!
  *  @brief  Read value from sensor or return last one from less than two
- *seconds.
+ *seconds. Blocking wrapper around startRead() and poll().
  *  @param  force
  *          true if using force mode
  *	@return float value
  */
 bool DHT::read(bool force) {
   // Check if sensor was read less than two seconds ago and return early
-  // to use last reading.
+  // to use last reading. A transaction started with startRead() keeps
+  // running in the background unless the caller forces a fresh reading.
+  if (!startRead(force) && (_state == DHT_STATE_IDLE || !force)) {
+    return _lastresult; // return last correct measurement
+  }
+  while (poll() == DHT_READ_BUSY) {
+    delay(1);
+  }
+  return _lastresult;
+}
+
+/*!
+ *  @brief  Start a sensor transaction without waiting for it. Only the
+ *          start signal is driven here; call poll() until it stops
+ *          returning DHT_READ_BUSY. Until then read() and the readXXX()
+ *          functions without force keep returning the previous reading.
+ *  @param  force
+ *          true to ignore the two second minimum interval
+ *  @return true if a transaction was started, false if one is already
+ *          running or the last reading is still fresh
+ */
+bool DHT::startRead(bool force) {
+  if (_state != DHT_STATE_IDLE) {
+    return false;
+  }
   uint32_t currenttime = millis();
   if (!force && ((currenttime - _lastreadtime) < MIN_INTERVAL)) {
-    return _lastresult; // return last correct measurement
+    return false;
   }
-  _lastreadtime = currenttime;
+  _attempt = 0;
+  beginTransaction();
+  return true;
+}
 
-  // Reset 40 bits of received data to zero.
-  data[0] = data[1] = data[2] = data[3] = data[4] = 0;
+/*!
+ *  @brief  Drive the start of one attempt of the transaction
+ */
+void DHT::beginTransaction() {
+  _lastreadtime = millis();
+  _lastreadmicros = micros();
+  _lasterror = DHT_ERROR_TIMEOUT;
+
+#ifdef DHT_USE_RMT
+  if (_rmtChannel != NULL) {
+    // The pin is open-drain, so the start signal can begin right away
+    gpio_set_level((gpio_num_t)_pin, 0);
+    enterState(DHT_STATE_START, startSignalMicros());
+    return;
+  }
+#endif
 
 #if defined(ESP8266)
   yield(); // Handle WiFi / reset software watchdog
@@ -250,21 +344,171 @@ bool DHT::read(bool force) {
   // Go into high impedence state to let pull-up raise data line level and
   // start the reading process.
   pinMode(_pin, INPUT_PULLUP);
-  delay(1);
+  enterState(DHT_STATE_PULLUP, 1000);
+}
+
+/*!
+ *  @brief  Advance the transaction started by startRead(). Each phase of
+ *          the start signal lasts at least as long as the datasheet asks;
+ *          calling poll() late only makes it longer. With RMT the frame is
+ *          captured in the background, otherwise the ~5 ms capture runs
+ *          inside the poll() that ends the start signal.
+ *  @return DHT_READ_BUSY while the transaction is running, DHT_READ_DONE
+ *          once when it finishes (see lastError()), DHT_READ_IDLE otherwise
+ */
+uint8_t DHT::poll() {
+  switch (_state) {
+  case DHT_STATE_PULLUP:
+    if (micros() - _statestart < _statelen) {
+      return DHT_READ_BUSY;
+    }
+    // First set data line low for a period according to sensor type
+    pinMode(_pin, OUTPUT);
+    digitalWrite(_pin, LOW);
+    enterState(DHT_STATE_START, startSignalMicros());
+    return DHT_READ_BUSY;
+
+  case DHT_STATE_START:
+    if (micros() - _statestart < _statelen) {
+      return DHT_READ_BUSY;
+    }
+#ifdef DHT_USE_RMT
+    if (_rmtChannel != NULL) {
+      if (armRmt()) {
+        enterState(DHT_STATE_RMT, 20000);
+        return DHT_READ_BUSY;
+      }
+      return finish(false);
+    }
+#endif
+    return finish(capture());
+
+#ifdef DHT_USE_RMT
+  case DHT_STATE_RMT:
+    return pollRmt();
+#endif
 
-  // First set data line low for a period according to sensor type
-  pinMode(_pin, OUTPUT);
-  digitalWrite(_pin, LOW);
+  case DHT_STATE_RETRY:
+    if (micros() - _statestart < _statelen) {
+      return DHT_READ_BUSY;
+    }
+    beginTransaction();
+    return DHT_READ_BUSY;
+
+  default:
+    return DHT_READ_IDLE;
+  }
+}
+
+/*!
+ *  @brief  Length of the low start signal for this sensor type
+ *  @return microseconds
+ */
+uint32_t DHT::startSignalMicros() {
   switch (_type) {
   case DHT22:
   case DHT21:
-    delayMicroseconds(1100); // data sheet says "at least 1ms"
-    break;
+    return 1100; // data sheet says "at least 1ms"
   case DHT11:
   default:
-    delay(20); // data sheet says at least 18ms, 20ms just to be safe
-    break;
+    return 20000; // data sheet says at least 18ms, 20ms just to be safe
   }
+}
+
+/*!
+ *  @brief  Enter a timed phase of the transaction
+ *  @param  state
+ *          next DHT_STATE_*
+ *  @param  usec
+ *          minimum duration of the phase
+ */
+void DHT::enterState(uint8_t state, uint32_t usec) {
+  _state = state;
+  _statestart = micros();
+  _statelen = usec;
+}
+
+/*!
+ *  @brief  End an attempt: count it, then either schedule a retry or end
+ *          the transaction
+ *  @param  ok
+ *          true if the attempt decoded a good frame
+ *  @return DHT_READ_BUSY if a retry is pending, DHT_READ_DONE otherwise
+ */
+uint8_t DHT::finish(bool ok) {
+  if (ok) {
+    _stats.successes++;
+  } else if (_lasterror == DHT_ERROR_CHECKSUM) {
+    _stats.checksumErrors++;
+  } else {
+    _stats.timeouts++;
+  }
+
+  if (!ok && _attempt < _retries) {
+    _attempt++;
+    _stats.retries++;
+    // The sensor only starts a new measurement after its minimum interval
+    enterState(DHT_STATE_RETRY, _type == DHT11 ? 1000000UL : 2000000UL);
+    return DHT_READ_BUSY;
+  }
+  _lastresult = ok;
+  _state = DHT_STATE_IDLE;
+  return DHT_READ_DONE;
+}
+
+/*!
+ *  @brief  Pick the width that separates 0 bits from 1 bits in a frame. The
+ *          high pulses fall in two groups (26-28 us for 0, ~70 us for 1);
+ *          the threshold is refined to halfway between the averages of the
+ *          two groups, so it follows the sensor's actual timing instead of
+ *          the nominal one. When all bits look alike (e.g. a frame of
+ *          zeros) there is only one group, and the bits are compared with
+ *          the ~50 us low pulse like before.
+ *  @param  high
+ *          widths of the 40 high pulses
+ *  @param  lowAverage
+ *          average width of the 40 low pulses, in the same unit
+ *  @return a high pulse wider than this is a 1
+ */
+uint32_t DHT::bitThreshold(const uint32_t *high, uint32_t lowAverage) {
+  uint32_t lo = high[0], hi = high[0];
+  for (int i = 1; i < 40; ++i) {
+    if (high[i] < lo) {
+      lo = high[i];
+    }
+    if (high[i] > hi) {
+      hi = high[i];
+    }
+  }
+  if (hi == lo || hi - lo < lowAverage / 2) {
+    return lowAverage;
+  }
+
+  uint32_t threshold = lo + (hi - lo) / 2;
+  for (int round = 0; round < 8; ++round) {
+    uint32_t sum[2] = {0, 0}, count[2] = {0, 0};
+    for (int i = 0; i < 40; ++i) {
+      int group = high[i] > threshold;
+      sum[group] += high[i];
+      count[group]++;
+    }
+    // Both groups are never empty: lo <= threshold < hi
+    uint32_t next = (sum[0] / count[0] + sum[1] / count[1]) / 2;
+    if (next == threshold) {
+      break;
+    }
+    threshold = next;
+  }
+  return threshold;
+}
+
+/*!
+ *  @brief  End the start signal and bit-bang the sensor's answer
+ *  @return true if 40 bits were received and the checksum matches
+ */
+bool DHT::capture() {
+  // Reset 40 bits of received data to zero.
+  data[0] = data[1] = data[2] = data[3] = data[4] = 0;
 
   uint32_t cycles[80];
   {
@@ -284,15 +528,12 @@ bool DHT::read(bool force) {
     // for ~80 microseconds again.
     if (expectPulse(LOW) == TIMEOUT) {
       DEBUG_PRINTLN(F("DHT timeout waiting for start signal low pulse."));
-      _lastresult = false;
-      return _lastresult;
+      return false;
     }
     if (expectPulse(HIGH) == TIMEOUT) {
       DEBUG_PRINTLN(F("DHT timeout waiting for start signal high pulse."));
-      _lastresult = false;
-      return _lastresult;
+      return false;
     }
-
     // Now read the 40 bits sent by the sensor.  Each bit is sent as a 50
     // microsecond low pulse followed by a variable length high pulse.  If the
     // high pulse is ~28 microseconds then it's a 0 and if it's ~70 microseconds
@@ -307,25 +548,26 @@ bool DHT::read(bool force) {
     }
   } // Timing critical code is now complete.
 
-  // Inspect pulses and determine which ones are 0 (high state cycle count < low
-  // state cycle count), or 1 (high state cycle count > low state cycle count).
+  // Inspect pulses and determine which ones are 0 (short high state) or 1
+  // (long high state), with a threshold taken from this frame's own widths.
+  uint32_t high[40];
+  uint32_t lowTotal = 0;
   for (int i = 0; i < 40; ++i) {
     uint32_t lowCycles = cycles[2 * i];
     uint32_t highCycles = cycles[2 * i + 1];
     if ((lowCycles == TIMEOUT) || (highCycles == TIMEOUT)) {
       DEBUG_PRINTLN(F("DHT timeout waiting for pulse."));
-      _lastresult = false;
-      return _lastresult;
+      return false;
     }
+    high[i] = highCycles;
+    lowTotal += lowCycles;
+  }
+  uint32_t threshold = bitThreshold(high, lowTotal / 40);
+  for (int i = 0; i < 40; ++i) {
     data[i / 8] <<= 1;
-    // Now compare the low and high cycle times to see if the bit is a 0 or 1.
-    if (highCycles > lowCycles) {
-      // High cycles are greater than 50us low cycle count, must be a 1.
+    if (high[i] > threshold) {
       data[i / 8] |= 1;
     }
-    // Else high cycles are less than (or equal to, a weird case) the 50us low
-    // cycle count so this must be a zero.  Nothing needs to be changed in the
-    // stored data.
   }
 
   DEBUG_PRINTLN(F("Received from DHT:"));
@@ -343,12 +585,12 @@ bool DHT::read(bool force) {
 
   // Check we read 40 bits and that the checksum matches.
   if (data[4] == ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
-    _lastresult = true;
-    return _lastresult;
+    _lasterror = DHT_ERROR_NONE;
+    return true;
   } else {
     DEBUG_PRINTLN(F("DHT checksum failure!"));
-    _lastresult = false;
-    return _lastresult;
+    _lasterror = DHT_ERROR_CHECKSUM;
+    return false;
   }
 }
 
@@ -388,3 +630,160 @@ uint32_t DHT::expectPulse(bool level) {
 
   return count;
 }
+
+#ifdef DHT_USE_RMT
+
+/*!
+ *  @brief  RMT receive-done callback, runs in ISR context
+ */
+static bool IRAM_ATTR dhtRmtDone(rmt_channel_handle_t channel,
+                                 const rmt_rx_done_event_data_t *edata,
+                                 void *ctx) {
+  BaseType_t woken = pdFALSE;
+  (void)channel;
+  xQueueSendFromISR((QueueHandle_t)ctx, edata, &woken);
+  return woken == pdTRUE;
+}
+
+/*!
+ *  @brief  Set up an RMT receive channel on the data pin, with 1 us
+ *          resolution. The pin is switched to open-drain so the start
+ *          signal can be driven while RMT keeps watching the line.
+ *  @return true if the channel is ready, false to use bit-banging
+ */
+bool DHT::beginRmt() {
+  rmt_rx_channel_config_t config = {};
+  config.gpio_num = (gpio_num_t)_pin;
+  config.clk_src = RMT_CLK_SRC_DEFAULT;
+  config.resolution_hz = 1000000;
+  config.mem_block_symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL;
+
+  if (rmt_new_rx_channel(&config, &_rmtChannel) != ESP_OK) {
+    _rmtChannel = NULL;
+    return false;
+  }
+
+  _rmtQueue = xQueueCreateStatic(1, sizeof(rmt_rx_done_event_data_t),
+                                 _rmtQueueStorage, &_rmtQueueState);
+  rmt_rx_event_callbacks_t callbacks = {};
+  callbacks.on_recv_done = dhtRmtDone;
+  if (rmt_rx_register_event_callbacks(_rmtChannel, &callbacks, _rmtQueue) !=
+          ESP_OK ||
+      rmt_enable(_rmtChannel) != ESP_OK) {
+    rmt_del_channel(_rmtChannel);
+    _rmtChannel = NULL;
+    return false;
+  }
+
+  // rmt_new_rx_channel() left the pin as a plain input
+  gpio_set_direction((gpio_num_t)_pin, GPIO_MODE_INPUT_OUTPUT_OD);
+  gpio_set_pull_mode((gpio_num_t)_pin, GPIO_PULLUP_ONLY);
+  gpio_set_level((gpio_num_t)_pin, 1);
+  return true;
+}
+
+/*!
+ *  @brief  Arm the RMT receiver and end the start signal. The receiver is
+ *          armed while the line is still low: capture starts on the
+ *          release edge, so the sensor's response is never missed.
+ *  @return true if the receiver is waiting for the frame
+ */
+bool DHT::armRmt() {
+  rmt_receive_config_t config = {};
+  config.signal_range_min_ns = 1000;   // Ignore glitches shorter than 1 us
+  config.signal_range_max_ns = 200000; // 200 us without edges ends the frame
+
+  xQueueReset(_rmtQueue);
+  if (rmt_receive(_rmtChannel, _rmtSymbols, sizeof(_rmtSymbols), &config) !=
+      ESP_OK) {
+    gpio_set_level((gpio_num_t)_pin, 1);
+    return false;
+  }
+  gpio_set_level((gpio_num_t)_pin, 1);
+  return true;
+}
+
+/*!
+ *  @brief  Check whether RMT has captured the ~4 ms frame, without
+ *          waiting. Interrupts stay enabled during the capture; the pulse
+ *          widths are decoded with the same rule as the bit-banging reader
+ *          (see bitThreshold()).
+ *  @return DHT_READ_BUSY while waiting, DHT_READ_DONE when finished
+ */
+uint8_t DHT::pollRmt() {
+  rmt_rx_done_event_data_t done;
+  if (xQueueReceive(_rmtQueue, &done, 0) != pdTRUE) {
+    if (micros() - _statestart < _statelen) {
+      return DHT_READ_BUSY;
+    }
+    DEBUG_PRINTLN(F("DHT timeout waiting for RMT frame."));
+    // Abort the pending reception
+    rmt_disable(_rmtChannel);
+    rmt_enable(_rmtChannel);
+    return finish(false);
+  }
+  return finish(decodeRmt(done));
+}
+
+/*!
+ *  @brief  Decode a captured RMT frame into data[]
+ *  @param  done
+ *          symbols received by the RMT channel
+ *  @return true if 40 bits were received and the checksum matches
+ */
+bool DHT::decodeRmt(const rmt_rx_done_event_data_t &done) {
+  // Reset 40 bits of received data to zero.
+  data[0] = data[1] = data[2] = data[3] = data[4] = 0;
+
+  // Flatten the symbols into alternating (level, duration) pulses
+  uint16_t level[2 * 64], width[2 * 64];
+  size_t pulses = 0;
+  for (size_t i = 0; i < done.num_symbols; i++) {
+    const rmt_symbol_word_t &s = done.received_symbols[i];
+    if (s.duration0) {
+      level[pulses] = s.level0;
+      width[pulses++] = s.duration0;
+    }
+    if (s.duration1) {
+      level[pulses] = s.level1;
+      width[pulses++] = s.duration1;
+    }
+  }
+
+  // The sensor answers with ~80 us low and ~80 us high, then 40 bits of
+  // (~50 us low, 26-28 us or ~70 us high)
+  size_t p = 0;
+  while (p + 1 < pulses && !(level[p] == 0 && width[p] > 60 &&
+                             level[p + 1] == 1 && width[p + 1] > 60)) {
+    p++;
+  }
+  p += 2;
+  if (p + 80 > pulses) {
+    DEBUG_PRINTLN(F("DHT RMT frame too short."));
+    return false;
+  }
+
+  uint32_t high[40];
+  uint32_t lowTotal = 0;
+  for (int i = 0; i < 40; ++i, p += 2) {
+    high[i] = width[p + 1];
+    lowTotal += width[p];
+  }
+  uint32_t threshold = bitThreshold(high, lowTotal / 40);
+  for (int i = 0; i < 40; ++i) {
+    data[i / 8] <<= 1;
+    if (high[i] > threshold) {
+      data[i / 8] |= 1;
+    }
+  }
+
+  if (data[4] == ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
+    _lasterror = DHT_ERROR_NONE;
+    return true;
+  }
+  DEBUG_PRINTLN(F("DHT checksum failure!"));
+  _lasterror = DHT_ERROR_CHECKSUM;
+  return false;
+}
+
+#endif
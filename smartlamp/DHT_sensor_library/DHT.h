@@ -20,6 +20,21 @@
 
 #include "Arduino.h"
 
+/* On ESP32 with ESP-IDF 5 the waveform is captured by the RMT peripheral
+ * instead of busy-waiting with interrupts disabled. Define DHT_NO_RMT to
+ * force the portable bit-banging reader. */
+#if defined(ARDUINO_ARCH_ESP32) && !defined(DHT_NO_RMT)
+#include "esp_idf_version.h"
+#if ESP_IDF_VERSION_MAJOR >= 5
+#define DHT_USE_RMT
+#include "driver/gpio.h"
+#include "driver/rmt_rx.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "soc/soc_caps.h"
+#endif
+#endif
+
 /* Uncomment to enable printing out nice debug messages. */
 //#define DHT_DEBUG
 
@@ -47,6 +62,29 @@ static const uint8_t DHT21{21};  /**< DHT TYPE 21 */
 static const uint8_t DHT22{22};  /**< DHT TYPE 22 */
 static const uint8_t AM2301{21}; /**< AM2301 */
 
+/* Why the last sensor transaction failed, as returned by lastError(). */
+static const uint8_t DHT_ERROR_NONE{0};     /**< Last read succeeded */
+static const uint8_t DHT_ERROR_TIMEOUT{1};  /**< Sensor did not answer */
+static const uint8_t DHT_ERROR_CHECKSUM{2}; /**< Bits received, bad checksum */
+
+/* Results of poll(), the non-blocking reader. */
+static const uint8_t DHT_READ_IDLE{0}; /**< No transaction in progress */
+static const uint8_t DHT_READ_BUSY{1}; /**< Call poll() again later */
+static const uint8_t DHT_READ_DONE{2}; /**< Finished, see lastError() */
+
+/*!
+ *  @brief  Quality counters of a sensor, as returned by stats(). Each
+ *          attempt counts once: a reading that fails and then succeeds on
+ *          a retry adds one to timeouts or checksumErrors, one to retries
+ *          and one to successes.
+ */
+struct dht_stats_t {
+  uint32_t successes;      /**< Attempts with a good checksum */
+  uint32_t retries;        /**< Attempts repeated after a failure */
+  uint32_t timeouts;       /**< Attempts the sensor did not answer */
+  uint32_t checksumErrors; /**< Attempts with a bad checksum */
+};
+
 #if defined(TARGET_NAME) && (TARGET_NAME == ARDUINO_NANO33BLE)
 #ifndef microsecondsToClockCycles
 /*!
@@ -72,6 +110,12 @@ public:
                          bool isFahrenheit = true);
   float readHumidity(bool force = false);
   bool read(bool force = false);
+  bool startRead(bool force = false);
+  uint8_t poll();
+  uint32_t lastReadMicros();
+  uint8_t lastError();
+  void setRetries(uint8_t retries);
+  dht_stats_t stats();
 
 private:
   uint8_t data[5];
@@ -83,10 +127,35 @@ private:
   uint8_t _bit, _port;
 #endif
   uint32_t _lastreadtime, _maxcycles;
+  uint32_t _lastreadmicros;
   bool _lastresult;
+  uint8_t _lasterror;
+  uint8_t _state;                  // DHT_STATE_* in DHT.cpp
+  uint32_t _statestart, _statelen; // micros() and length of the phase
+  uint8_t _retries, _attempt;      // retries allowed, retries done
+  dht_stats_t _stats;
   uint8_t pullTime; // Time (in usec) to pull up data line before reading
 
   uint32_t expectPulse(bool level);
+  uint32_t startSignalMicros();
+  void enterState(uint8_t state, uint32_t usec);
+  void beginTransaction();
+  uint8_t finish(bool ok);
+  bool capture();
+  static uint32_t bitThreshold(const uint32_t *high, uint32_t lowAverage);
+
+#ifdef DHT_USE_RMT
+  rmt_channel_handle_t _rmtChannel;
+  QueueHandle_t _rmtQueue;
+  StaticQueue_t _rmtQueueState;
+  uint8_t _rmtQueueStorage[sizeof(rmt_rx_done_event_data_t)];
+  rmt_symbol_word_t _rmtSymbols[64];
+
+  bool beginRmt();
+  bool armRmt();
+  uint8_t pollRmt();
+  bool decodeRmt(const rmt_rx_done_event_data_t &done);
+#endif
 };
 
 /*!
@@ -0,0 +1,119 @@
+/*!
+ *  @file DHT_Bus.cpp
+ *
+ *  Reads several DHT sensors at once. All start signals are driven
+ *  together through DHT::startRead(); the sensors are then polled in turn.
+ *  Sensors with an RMT channel are captured in parallel in the background;
+ *  bit-banged ones are captured one after the other (each capture keeps
+ *  interrupts off for ~5 ms), which only lengthens the start signal of the
+ *  sensors still waiting, and that is within the datasheet.
+ *
+ *  MIT license, all text above must be included in any redistribution
+ */
+
+#include "DHT_Bus.h"
+
+/*!
+ *  @brief  Instantiates a new DHT_Bus
+ *  @param  sensors
+ *          array of sensors, each already constructed with its pin and
+ *          type; it must outlive the bus
+ *  @param  count
+ *          number of sensors in the array
+ */
+DHT_Bus::DHT_Bus(DHT *const *sensors, uint8_t count)
+    : _sensors(sensors), _count(count), _busy(false) {}
+
+/*!
+ *  @brief  Setup all sensors (calls begin on each). On ESP32 each sensor
+ *          takes an RMT receive channel while they last; the rest fall
+ *          back to bit-banging.
+ *  @param  usec
+ *          pull-up time before each reading, as in DHT::begin()
+ */
+void DHT_Bus::begin(uint8_t usec) {
+  for (uint8_t i = 0; i < _count; i++) {
+    _sensors[i]->begin(usec);
+  }
+}
+
+/*!
+ *  @brief  Start a transaction on every sensor without waiting. Call poll()
+ *          until it stops returning DHT_READ_BUSY.
+ *  @return true if at least one sensor started
+ */
+bool DHT_Bus::startRead() {
+  bool started = false;
+  for (uint8_t i = 0; i < _count; i++) {
+    started |= _sensors[i]->startRead(true);
+  }
+  _busy = _busy || started;
+  return started;
+}
+
+/*!
+ *  @brief  Advance every sensor's transaction
+ *  @return DHT_READ_BUSY while any sensor is still running, DHT_READ_DONE
+ *          once when all have finished, DHT_READ_IDLE otherwise
+ */
+uint8_t DHT_Bus::poll() {
+  bool busy = false;
+  for (uint8_t i = 0; i < _count; i++) {
+    busy |= _sensors[i]->poll() == DHT_READ_BUSY;
+  }
+  if (busy) {
+    return DHT_READ_BUSY;
+  }
+  if (_busy) {
+    _busy = false;
+    return DHT_READ_DONE;
+  }
+  return DHT_READ_IDLE;
+}
+
+/*!
+ *  @brief  Collect the result of the last transaction of each sensor. Call
+ *          it right after poll() returns DHT_READ_DONE: past the sensors'
+ *          two second minimum interval, readTemperature() would start a
+ *          new blocking reading.
+ *  @param  readings
+ *          array of count() results, in the order of the sensors
+ *  @return number of valid readings
+ */
+uint8_t DHT_Bus::getReadings(dht_reading_t *readings) {
+  uint8_t valid = 0;
+  for (uint8_t i = 0; i < _count; i++) {
+    DHT *sensor = _sensors[i];
+    dht_reading_t &r = readings[i];
+    r.temperature = sensor->readTemperature();
+    r.humidity = sensor->readHumidity();
+    r.micros = sensor->lastReadMicros();
+    r.error = sensor->lastError();
+    r.valid = r.error == DHT_ERROR_NONE && !isnan(r.temperature) &&
+              !isnan(r.humidity);
+    if (r.valid) {
+      valid++;
+    }
+  }
+  return valid;
+}
+
+/*!
+ *  @brief  Read all sensors, blocking until every one has finished
+ *  @param  readings
+ *          array of count() results, in the order of the sensors
+ *  @return number of valid readings
+ */
+uint8_t DHT_Bus::read(dht_reading_t *readings) {
+  startRead();
+  while (poll() == DHT_READ_BUSY) {
+    delay(1);
+  }
+  return getReadings(readings);
+}
+
+/*!
+ *  @brief  Number of sensors on the bus
+ *  @return count given to the constructor
+ */
+uint8_t DHT_Bus::count() const { return _count; }
@@ -0,0 +1,46 @@
+/*!
+ *  @file DHT_Bus.h
+ *
+ *  Reads several DHT sensors at once, each on its own pin, overlapping
+ *  their start signals and (with RMT) their captures, so the whole set is
+ *  refreshed in about the time of a single reading.
+ *
+ *  MIT license, all text above must be included in any redistribution
+ */
+
+#ifndef DHT_BUS_H
+#define DHT_BUS_H
+
+#include "DHT.h"
+
+/*!
+ *  @brief  Result of one sensor in a DHT_Bus reading
+ */
+struct dht_reading_t {
+  float temperature; /**< Celsius, NAN if the reading failed */
+  float humidity;    /**< Percent, NAN if the reading failed */
+  uint32_t micros;   /**< micros() when the transaction started */
+  uint8_t error;     /**< DHT_ERROR_* of the transaction */
+  bool valid;        /**< Temperature and humidity are usable */
+};
+
+/*!
+ *  @brief  Class that reads a group of DHT sensors together
+ */
+class DHT_Bus {
+public:
+  DHT_Bus(DHT *const *sensors, uint8_t count);
+  void begin(uint8_t usec = 55);
+  bool startRead();
+  uint8_t poll();
+  uint8_t getReadings(dht_reading_t *readings);
+  uint8_t read(dht_reading_t *readings);
+  uint8_t count() const;
+
+private:
+  DHT *const *_sensors;
+  uint8_t _count;
+  bool _busy;
+};
+
+#endif
@@ -0,0 +1,244 @@
+/*!
+ *  @file DHT_Static.h
+ *
+ *  Header-only DHT reader specialized at compile time on the data pin and
+ *  the sensor type. The type checks in the conversions fold away, and on
+ *  ESP32 the pulses are sampled straight from the GPIO input register and
+ *  timed with the CPU cycle counter instead of going through digitalRead()
+ *  and counting loop iterations, so every pulse width is measured in real
+ *  time and the timeout is the same whatever the loop costs.
+ *
+ *  It keeps the blocking reader of the original library: read() holds the
+ *  line low for the whole start signal (20 ms on DHT11/DHT12, 1.1 ms on
+ *  DHT21/DHT22) and then bit-bangs the ~4 ms frame with interrupts
+ *  disabled. There is no startRead()/poll() and no retry, and each bit is
+ *  decoded on its own (1 when its high pulse outlasts the low pulse before
+ *  it) instead of with the threshold DHT::bitThreshold() fits to the frame.
+ *  Use DHT where those matter or where an RMT channel is free.
+ *
+ *  MIT license, all text above must be included in any redistribution
+ */
+
+#ifndef DHT_STATIC_H
+#define DHT_STATIC_H
+
+#include "DHT.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include "soc/gpio_reg.h"
+#include "soc/soc.h"
+#include "soc/soc_caps.h"
+#define DHT_STATIC_GPIO_REG
+#endif
+
+#define DHT_STATIC_MIN_INTERVAL 2000 /**< ms between sensor transactions */
+#define DHT_STATIC_TIMEOUT_US 200 /**< Longest pulse accepted (frame: ~85) */
+#define DHT_STATIC_TIMEOUT UINT32_MAX /**< expectPulse() result on timeout */
+
+/*!
+ *  @brief  DHT reader for a sensor of type Type on pin Pin
+ */
+template <uint8_t Pin, uint8_t Type> class DHT_Static {
+public:
+  static_assert(Type == DHT11 || Type == DHT12 || Type == DHT21 ||
+                    Type == DHT22,
+                "unknown DHT type");
+#ifdef DHT_STATIC_GPIO_REG
+  static_assert(Pin < SOC_GPIO_PIN_COUNT, "no such GPIO");
+#endif
+
+  DHT_Static()
+      : _lastreadtime(0), _lastreadmicros(0), _maxcycles(0),
+        _lastresult(false), _lasterror(DHT_ERROR_NONE), _pullTime(55) {}
+
+  /*!
+   *  @brief  Setup the pin and calibrate the pulse timeout for the current
+   *          CPU clock
+   *  @param  usec
+   *          pull-up time (in microseconds) before the sensor answers
+   */
+  void begin(uint8_t usec = 55) {
+    pinMode(Pin, INPUT_PULLUP);
+    _lastreadtime = millis() - DHT_STATIC_MIN_INTERVAL;
+    _lastreadmicros = micros();
+    _pullTime = usec;
+#ifdef DHT_STATIC_GPIO_REG
+    _maxcycles = ESP.getCpuFreqMHz() * DHT_STATIC_TIMEOUT_US;
+#else
+    _maxcycles = microsecondsToClockCycles(1000);
+#endif
+  }
+
+  /*!
+   *  @brief  Read the sensor, or keep the last reading if it is less than
+   *          two seconds old. Blocks for the start signal and the frame
+   *          (~25 ms on DHT11), with interrupts off during the frame.
+   *  @param  force
+   *          true to ignore the minimum interval
+   *  @return true if 40 bits were received and the checksum matches
+   */
+  bool read(bool force = false) {
+    uint32_t currenttime = millis();
+    if (!force && ((currenttime - _lastreadtime) < DHT_STATIC_MIN_INTERVAL)) {
+      return _lastresult;
+    }
+    _lastreadtime = currenttime;
+    _lastreadmicros = micros();
+    _lasterror = DHT_ERROR_TIMEOUT;
+    _lastresult = false;
+
+    // Start signal, as in DHT::read()
+    pinMode(Pin, INPUT_PULLUP);
+    delay(1);
+    pinMode(Pin, OUTPUT);
+    digitalWrite(Pin, LOW);
+    if (Type == DHT22 || Type == DHT21) {
+      delayMicroseconds(1100);
+    } else {
+      delay(20);
+    }
+
+    uint32_t cycles[80];
+    {
+      pinMode(Pin, INPUT_PULLUP);
+      delayMicroseconds(_pullTime);
+
+      InterruptLock lock;
+      if (expectPulse(LOW) == DHT_STATIC_TIMEOUT ||
+          expectPulse(HIGH) == DHT_STATIC_TIMEOUT) {
+        return false;
+      }
+      for (int i = 0; i < 80; i += 2) {
+        cycles[i] = expectPulse(LOW);
+        cycles[i + 1] = expectPulse(HIGH);
+      }
+    }
+
+    // A bit is 1 when its high pulse outlasts the ~50 us low pulse before it
+    uint8_t bytes[5] = {0, 0, 0, 0, 0};
+    for (int i = 0; i < 40; ++i) {
+      if (cycles[2 * i] == DHT_STATIC_TIMEOUT ||
+          cycles[2 * i + 1] == DHT_STATIC_TIMEOUT) {
+        return false;
+      }
+      bytes[i / 8] = (bytes[i / 8] << 1) | (cycles[2 * i + 1] > cycles[2 * i]);
+    }
+
+    if (bytes[4] != ((bytes[0] + bytes[1] + bytes[2] + bytes[3]) & 0xFF)) {
+      _lasterror = DHT_ERROR_CHECKSUM;
+      return false;
+    }
+    memcpy(data, bytes, sizeof(data));
+    _lasterror = DHT_ERROR_NONE;
+    _lastresult = true;
+    return true;
+  }
+
+  /*!
+   *  @brief  Read temperature
+   *  @param  S
+   *          true for Fahrenheit, false for Celsius
+   *  @param  force
+   *          true to ignore the minimum interval
+   *  @return temperature, NAN if the reading failed
+   */
+  float readTemperature(bool S = false, bool force = false) {
+    if (!read(force)) {
+      return NAN;
+    }
+    float f;
+    if (Type == DHT11) {
+      f = data[2];
+      if (data[3] & 0x80) {
+        f = -1 - f;
+      }
+      f += (data[3] & 0x0f) * 0.1;
+    } else if (Type == DHT12) {
+      f = data[2];
+      f += (data[3] & 0x0f) * 0.1;
+      if (data[2] & 0x80) {
+        f *= -1;
+      }
+    } else {
+      f = ((word)(data[2] & 0x7F)) << 8 | data[3];
+      f *= 0.1;
+      if (data[2] & 0x80) {
+        f *= -1;
+      }
+    }
+    return S ? f * 1.8 + 32 : f;
+  }
+
+  /*!
+   *  @brief  Read humidity
+   *  @param  force
+   *          true to ignore the minimum interval
+   *  @return humidity in percent, NAN if the reading failed
+   */
+  float readHumidity(bool force = false) {
+    if (!read(force)) {
+      return NAN;
+    }
+    if (Type == DHT11 || Type == DHT12) {
+      return data[0] + data[1] * 0.1;
+    }
+    return (((word)data[0]) << 8 | data[1]) * 0.1;
+  }
+
+  /*!
+   *  @brief  Time of the last actual sensor transaction
+   *  @return micros() value when the last reading was started
+   */
+  uint32_t lastReadMicros() const { return _lastreadmicros; }
+
+  /*!
+   *  @brief  Why the last actual sensor transaction failed
+   *  @return DHT_ERROR_NONE, DHT_ERROR_TIMEOUT or DHT_ERROR_CHECKSUM
+   */
+  uint8_t lastError() const { return _lasterror; }
+
+private:
+  uint8_t data[5] = {0, 0, 0, 0, 0}; // Last good frame
+  uint32_t _lastreadtime, _lastreadmicros, _maxcycles;
+  bool _lastresult;
+  uint8_t _lasterror;
+  uint8_t _pullTime;
+
+  // Level of the data line
+  static inline bool level() {
+#ifdef DHT_STATIC_GPIO_REG
+#ifdef GPIO_IN1_REG
+    const uint32_t reg = Pin >= 32 ? GPIO_IN1_REG : GPIO_IN_REG;
+#else
+    const uint32_t reg = GPIO_IN_REG;
+#endif
+    return (REG_READ(reg) >> (Pin & 31)) & 1;
+#else
+    return digitalRead(Pin);
+#endif
+  }
+
+  // Width of the current pulse at the given level: CPU cycles on ESP32,
+  // loop iterations elsewhere. DHT_STATIC_TIMEOUT if it lasts too long.
+  uint32_t expectPulse(bool pulseLevel) {
+#ifdef DHT_STATIC_GPIO_REG
+    uint32_t start = ESP.getCycleCount();
+    while (level() == pulseLevel) {
+      if (ESP.getCycleCount() - start >= _maxcycles) {
+        return DHT_STATIC_TIMEOUT;
+      }
+    }
+    return ESP.getCycleCount() - start;
+#else
+    uint32_t count = 0;
+    while (level() == pulseLevel) {
+      if (count++ >= _maxcycles) {
+        return DHT_STATIC_TIMEOUT;
+      }
+    }
+    return count;
+#endif
+  }
+};
+
+#endif
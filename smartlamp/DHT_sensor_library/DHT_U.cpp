@@ -30,13 +30,74 @@
 DHT_Unified::DHT_Unified(uint8_t pin, uint8_t type, uint8_t count,
                          int32_t tempSensorId, int32_t humiditySensorId)
     : _dht(pin, type, count), _type(type), _temp(this, tempSensorId),
-      _humidity(this, humiditySensorId) {}
+      _humidity(this, humiditySensorId), _acquiredMicros(0), _timestamp(0) {}
 
 /*!
  *  @brief  Setup sensor (calls begin on It)
  */
 void DHT_Unified::begin() { _dht.begin(); }
 
+/*!
+ *  @brief  Reads temperature and humidity from one acquisition, so both
+ *          events carry the same values and timestamp
+ *  @param  events
+ *          array of events to fill: temperature first, then humidity
+ *  @param  count
+ *          number of events in the array
+ *  @return number of events filled (at most 2)
+ */
+size_t DHT_Unified::getEvents(sensors_event_t *events, size_t count) {
+  size_t filled = 0;
+
+  acquire();
+  if (filled < count) {
+    fillEvent(&events[filled++], _temp._id, SENSOR_TYPE_AMBIENT_TEMPERATURE);
+  }
+  if (filled < count) {
+    fillEvent(&events[filled++], _humidity._id, SENSOR_TYPE_RELATIVE_HUMIDITY);
+  }
+  return filled;
+}
+
+/*!
+ *  @brief  Shared acquisition cycle of both channels: reads the sensor at
+ *          most once per its minimum interval (DHT::read() keeps the last
+ *          reading in between) and stamps every event from that reading
+ *          with the time it was first seen
+ */
+void DHT_Unified::acquire() {
+  _dht.read();
+  if (_dht.lastReadMicros() != _acquiredMicros || _timestamp == 0) {
+    _acquiredMicros = _dht.lastReadMicros();
+    _timestamp = millis();
+  }
+}
+
+/*!
+ *  @brief  Fills an event from the current acquisition, without reading
+ *          the sensor
+ *  @param  event
+ *          event to fill
+ *  @param  id
+ *          sensor id of the channel
+ *  @param  type
+ *          SENSOR_TYPE_AMBIENT_TEMPERATURE or SENSOR_TYPE_RELATIVE_HUMIDITY
+ */
+void DHT_Unified::fillEvent(sensors_event_t *event, int32_t id, int32_t type) {
+  // Clear event definition.
+  memset(event, 0, sizeof(sensors_event_t));
+  // Populate sensor reading values.
+  event->version = sizeof(sensors_event_t);
+  event->sensor_id = id;
+  event->type = type;
+  event->timestamp = _timestamp;
+  if (type == SENSOR_TYPE_AMBIENT_TEMPERATURE) {
+    event->temperature = _dht.readTemperature();
+  } else {
+    event->relative_humidity = _dht.readHumidity();
+  }
+}
+
 /*!
  *  @brief  Sets sensor name
  *  @param  sensor
@@ -108,18 +169,25 @@ DHT_Unified::Temperature::Temperature(DHT_Unified *parent, int32_t id)
  *  @return always returns true
  */
 bool DHT_Unified::Temperature::getEvent(sensors_event_t *event) {
-  // Clear event definition.
-  memset(event, 0, sizeof(sensors_event_t));
-  // Populate sensor reading values.
-  event->version = sizeof(sensors_event_t);
-  event->sensor_id = _id;
-  event->type = SENSOR_TYPE_AMBIENT_TEMPERATURE;
-  event->timestamp = millis();
-  event->temperature = _parent->_dht.readTemperature();
+  _parent->acquire();
+  _parent->fillEvent(event, _id, SENSOR_TYPE_AMBIENT_TEMPERATURE);
 
   return true;
 }
 
+/*!
+ *  @brief  Reads both channels of the parent sensor from one acquisition
+ *  @param  events
+ *          array of events to fill: temperature first, then humidity
+ *  @param  count
+ *          number of events in the array
+ *  @return number of events filled (at most 2)
+ */
+size_t DHT_Unified::Temperature::getEvents(sensors_event_t *events,
+                                           size_t count) {
+  return _parent->getEvents(events, count);
+}
+
 /*!
  *  @brief  Provides the sensor_t data for this sensor
  *  @param  sensor
@@ -181,18 +249,25 @@ DHT_Unified::Humidity::Humidity(DHT_Unified *parent, int32_t id)
  *  @return always returns true
  */
 bool DHT_Unified::Humidity::getEvent(sensors_event_t *event) {
-  // Clear event definition.
-  memset(event, 0, sizeof(sensors_event_t));
-  // Populate sensor reading values.
-  event->version = sizeof(sensors_event_t);
-  event->sensor_id = _id;
-  event->type = SENSOR_TYPE_RELATIVE_HUMIDITY;
-  event->timestamp = millis();
-  event->relative_humidity = _parent->_dht.readHumidity();
+  _parent->acquire();
+  _parent->fillEvent(event, _id, SENSOR_TYPE_RELATIVE_HUMIDITY);
 
   return true;
 }
 
+/*!
+ *  @brief  Reads both channels of the parent sensor from one acquisition
+ *  @param  events
+ *          array of events to fill: temperature first, then humidity
+ *  @param  count
+ *          number of events in the array
+ *  @return number of events filled (at most 2)
+ */
+size_t DHT_Unified::Humidity::getEvents(sensors_event_t *events,
+                                        size_t count) {
+  return _parent->getEvents(events, count);
+}
+
 /*!
  *  @brief  Provides the sensor_t data for this sensor
  *  @param  sensor
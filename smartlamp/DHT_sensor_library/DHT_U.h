@@ -47,6 +47,7 @@ public:
   DHT_Unified(uint8_t pin, uint8_t type, uint8_t count = 6,
               int32_t tempSensorId = -1, int32_t humiditySensorId = -1);
   void begin();
+  size_t getEvents(sensors_event_t *events, size_t count);
 
   /*!
    *  @brief  Class that stores state and functions about Temperature
@@ -55,11 +56,14 @@ public:
   public:
     Temperature(DHT_Unified *parent, int32_t id);
     bool getEvent(sensors_event_t *event);
+    size_t getEvents(sensors_event_t *events, size_t count);
     void getSensor(sensor_t *sensor);
 
   private:
     DHT_Unified *_parent;
     int32_t _id;
+
+    friend class DHT_Unified;
   };
 
   /*!
@@ -69,11 +73,14 @@ public:
   public:
     Humidity(DHT_Unified *parent, int32_t id);
     bool getEvent(sensors_event_t *event);
+    size_t getEvents(sensors_event_t *events, size_t count);
     void getSensor(sensor_t *sensor);
 
   private:
     DHT_Unified *_parent;
     int32_t _id;
+
+    friend class DHT_Unified;
   };
 
   /*!
@@ -93,7 +100,11 @@ private:
   uint8_t _type;
   Temperature _temp;
   Humidity _humidity;
+  uint32_t _acquiredMicros; // DHT transaction the events come from
+  int32_t _timestamp;       // millis() when that transaction was seen
 
+  void acquire();
+  void fillEvent(sensors_event_t *event, int32_t id, int32_t type);
   void setName(sensor_t *sensor);
   void setMinDelay(sensor_t *sensor);
 };
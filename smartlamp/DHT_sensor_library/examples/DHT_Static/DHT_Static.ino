@@ -0,0 +1,59 @@
+// Example sketch for DHT_Static, the DHT reader specialized at compile time
+// on the data pin and the sensor type
+// Written for the SmartLamp firmware, public domain
+
+// REQUIRES the following Arduino libraries:
+// - DHT Sensor Library: https://github.com/adafruit/DHT-sensor-library
+// - Adafruit Unified Sensor Lib: https://github.com/adafruit/Adafruit_Sensor
+
+#include "DHT_Static.h"
+
+#define DHTPIN 2     // Digital pin connected to the DHT sensor
+
+// Uncomment whatever type you're using!
+//#define DHTTYPE DHT11   // DHT 11
+#define DHTTYPE DHT22   // DHT 22  (AM2302), AM2321
+//#define DHTTYPE DHT21   // DHT 21 (AM2301)
+
+// The pin and the type are template parameters, so a wrong type or (on
+// ESP32) a pin the chip does not have fails to compile.
+DHT_Static<DHTPIN, DHTTYPE> dht;
+
+// Unlike DHT, read() is the blocking reader of the original library: it
+// holds the line low for the start signal (20 ms on DHT11, 1.1 ms on DHT22)
+// and reads the ~4 ms frame with interrupts disabled, so call it where a
+// ~25 ms stall is fine. Each bit is a 1 when its high pulse outlasts the
+// low pulse before it; there is no adaptive threshold (DHT::bitThreshold),
+// no startRead()/poll() and no retry.
+
+void setup() {
+  Serial.begin(9600);
+  Serial.println(F("DHT_Static test!"));
+
+  dht.begin();
+}
+
+void loop() {
+  // Wait a few seconds between measurements.
+  delay(2000);
+
+  // One transaction serves both values: the second call reuses the frame
+  // read by the first, since it is less than two seconds old
+  float h = dht.readHumidity();
+  float t = dht.readTemperature();
+
+  if (isnan(h) || isnan(t)) {
+    Serial.print(F("Failed to read from DHT sensor: "));
+    Serial.println(dht.lastError() == DHT_ERROR_CHECKSUM ? F("checksum")
+                                                         : F("timeout"));
+    return;
+  }
+
+  Serial.print(F("Humidity: "));
+  Serial.print(h);
+  Serial.print(F("%  Temperature: "));
+  Serial.print(t);
+  Serial.print(F("°C  read at "));
+  Serial.print(dht.lastReadMicros());
+  Serial.println(F(" us"));
+}
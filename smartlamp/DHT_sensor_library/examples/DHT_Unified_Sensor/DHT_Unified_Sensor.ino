@@ -61,9 +61,11 @@ void setup() {
 void loop() {
   // Delay between measurements.
   delay(delayMS);
-  // Get temperature event and print its value.
-  sensors_event_t event;
-  dht.temperature().getEvent(&event);
+  // Get temperature and humidity events from the same reading.
+  sensors_event_t events[2];
+  dht.getEvents(events, 2);
+  // Print the temperature value.
+  sensors_event_t &event = events[0];
   if (isnan(event.temperature)) {
     Serial.println(F("Error reading temperature!"));
   }
@@ -72,14 +74,13 @@ void loop() {
     Serial.print(event.temperature);
     Serial.println(F("°C"));
   }
-  // Get humidity event and print its value.
-  dht.humidity().getEvent(&event);
-  if (isnan(event.relative_humidity)) {
+  // Print the humidity value.
+  if (isnan(events[1].relative_humidity)) {
     Serial.println(F("Error reading humidity!"));
   }
   else {
     Serial.print(F("Humidity: "));
-    Serial.print(event.relative_humidity);
+    Serial.print(events[1].relative_humidity);
     Serial.println(F("%"));
   }
 }
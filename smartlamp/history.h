@@ -0,0 +1,75 @@
+#ifndef SMARTLAMP_HISTORY_H
+#define SMARTLAMP_HISTORY_H
+
+// Histórico das leituras guardado na RAM do ESP32, para o host recuperar o
+// que perdeu enquanto o driver estava descarregado ou o cabo desligado.
+// Cada registro ocupa 12 bytes, com os valores em ponto fixo; o histórico
+// inteiro cabe num vetor fixo e o registro mais antigo é sobrescrito quando
+// ele enche. Não depende do Arduino.h, então também compila no host.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HISTORY_DHT_OK 0x01 // temp e hum valem (havia leitura boa e recente)
+
+// Registro como vai para o host: little-endian, sem preenchimento
+struct __attribute__((packed)) HistoryRecord {
+  uint32_t ms;   // millis() do ESP32
+  int16_t temp;  // Centésimos de °C
+  uint16_t hum;  // Décimos de % (por mil)
+  uint16_t ldr;  // Valor filtrado do ADC, 0..4095
+  uint8_t led;   // 0..100
+  uint8_t flags; // HISTORY_*
+};
+
+static_assert(sizeof(HistoryRecord) == 12, "HistoryRecord deve ter 12 bytes");
+
+template <size_t N>
+class HistoryRing {
+public:
+  HistoryRing() : start_(0), count_(0) {}
+
+  void push(const HistoryRecord &record) {
+    records_[(start_ + count_) % N] = record;
+    if (count_ < N)
+      count_++;
+    else
+      start_ = (start_ + 1) % N;
+  }
+
+  size_t size() const { return count_; }
+
+  // i = 0 é o registro mais antigo
+  const HistoryRecord &at(size_t i) const { return records_[(start_ + i) % N]; }
+
+  // Índice do primeiro registro feito em fromMs ou depois (size() se não
+  // houver). A comparação é circular, então vale através da volta do
+  // millis() enquanto o histórico cobrir menos de ~24 dias.
+  size_t firstSince(uint32_t fromMs) const {
+    size_t lo = 0, hi = count_;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if ((int32_t)(at(mid).ms - fromMs) >= 0)
+        hi = mid;
+      else
+        lo = mid + 1;
+    }
+    return lo;
+  }
+
+private:
+  HistoryRecord records_[N];
+  size_t start_, count_;
+};
+
+// Escreve o registro em hexadecimal (24 caracteres, sem terminador)
+inline void historyToHex(const HistoryRecord &record, char *out) {
+  static const char digits[] = "0123456789abcdef";
+  const uint8_t *bytes = (const uint8_t *)&record;
+  for (size_t i = 0; i < sizeof(record); i++) {
+    out[2 * i] = digits[bytes[i] >> 4];
+    out[2 * i + 1] = digits[bytes[i] & 0x0f];
+  }
+}
+
+#endif
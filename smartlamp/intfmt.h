@@ -0,0 +1,48 @@
+#ifndef SMARTLAMP_INTFMT_H
+#define SMARTLAMP_INTFMT_H
+
+// Conversão de inteiros para texto decimal sem printf: escreve dois dígitos
+// por divisão, usando uma tabela de "00" a "99". Serve para as respostas em
+// escala fixa (SET_FORMAT 1), que não passam por vsnprintf nem por float.
+// Não depende do Arduino.h, então também compila no host.
+
+#include <stdint.h>
+
+#define INTFMT_MAX 11 // Maior saída: "-2147483648"
+
+// Escreve value em out, sem terminador, e retorna o fim do que foi escrito
+inline char *intfmtUnsigned(char *out, uint32_t value) {
+  static const char pairs[] =
+      "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+      "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+      "8081828384858687888990919293949596979899";
+  char tmp[10];
+  char *p = tmp + sizeof(tmp);
+
+  while (value >= 100) {
+    const char *pair = pairs + 2 * (value % 100);
+    value /= 100;
+    *--p = pair[1];
+    *--p = pair[0];
+  }
+  if (value >= 10) {
+    *--p = pairs[2 * value + 1];
+    *--p = pairs[2 * value];
+  }
+  else {
+    *--p = '0' + value;
+  }
+  while (p < tmp + sizeof(tmp))
+    *out++ = *p++;
+  return out;
+}
+
+inline char *intfmtSigned(char *out, int32_t value) {
+  if (value < 0) {
+    *out++ = '-';
+    return intfmtUnsigned(out, -(uint32_t)value);
+  }
+  return intfmtUnsigned(out, value);
+}
+
+#endif
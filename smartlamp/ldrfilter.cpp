@@ -0,0 +1,42 @@
+#include "ldrfilter.h"
+
+LdrFilter::LdrFilter(uint8_t medianLen, uint8_t emaShift)
+    : len_(medianLen < 1 ? 1 : medianLen > LDRFILTER_MEDIAN_MAX ? LDRFILTER_MEDIAN_MAX : medianLen),
+      count_(0), pos_(0), shift_(0), ema_(0), primed_(false) {
+  setEmaShift(emaShift);
+}
+
+void LdrFilter::setEmaShift(uint8_t emaShift) {
+  shift_ = emaShift > LDRFILTER_EMA_MAX ? LDRFILTER_EMA_MAX : emaShift;
+}
+
+int32_t LdrFilter::median() const {
+  int32_t sorted[LDRFILTER_MEDIAN_MAX];
+
+  // Inserção: a janela tem no máximo LDRFILTER_MEDIAN_MAX elementos
+  for (uint8_t i = 0; i < count_; i++) {
+    int32_t v = window_[i];
+    uint8_t j = i;
+    for (; j > 0 && sorted[j - 1] > v; j--)
+      sorted[j] = sorted[j - 1];
+    sorted[j] = v;
+  }
+  return sorted[count_ / 2];
+}
+
+int32_t LdrFilter::add(int32_t raw) {
+  window_[pos_] = raw;
+  pos_ = (pos_ + 1) % len_;
+  if (count_ < len_)
+    count_++;
+
+  int32_t x = median() << 8;
+  if (!primed_) {
+    // A primeira amostra inicia a média, sem subir devagar a partir de zero
+    ema_ = x;
+    primed_ = true;
+  } else {
+    ema_ += (x - ema_) >> shift_;
+  }
+  return value();
+}
@@ -0,0 +1,36 @@
+#ifndef SMARTLAMP_LDRFILTER_H
+#define SMARTLAMP_LDRFILTER_H
+
+// Filtro das leituras do LDR: mediana de uma janela curta (tira picos
+// isolados) seguida de uma média móvel exponencial em ponto fixo (suaviza o
+// ruído). Só inteiros; não depende do Arduino.h, então também compila no host.
+
+#include <stdint.h>
+
+#define LDRFILTER_MEDIAN_MAX 9
+#define LDRFILTER_EMA_MAX 8
+
+class LdrFilter {
+public:
+  // medianLen: 1 (sem mediana) até LDRFILTER_MEDIAN_MAX, de preferência ímpar.
+  // emaShift: peso 1/2^emaShift para cada amostra nova; 0 desliga a média.
+  LdrFilter(uint8_t medianLen, uint8_t emaShift);
+
+  void setEmaShift(uint8_t emaShift);
+  uint8_t emaShift() const { return shift_; }
+
+  // Entra uma amostra e devolve o valor filtrado
+  int32_t add(int32_t raw);
+  int32_t value() const { return (ema_ + (1 << 7)) >> 8; }
+
+private:
+  int32_t window_[LDRFILTER_MEDIAN_MAX];
+  uint8_t len_, count_, pos_;
+  uint8_t shift_;
+  int32_t ema_; // Valor filtrado * 256
+  bool primed_;
+
+  int32_t median() const;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef SMARTLAMP_LEDGAMMA_H
+#define SMARTLAMP_LEDGAMMA_H
+
+// Tabela de brilho do LED: converte o valor do SET_LED (0..100) no duty cycle
+// do PWM seguindo a curva de luminosidade CIE 1931, em que o brilho percebido
+// L* vai de 0 a 100 e a luz emitida é proporcional a ((L* + 16) / 116)^3
+// (ou L* / 903.3 no trecho linear perto de zero). Assim cada passo do SET_LED
+// parece igual ao olho, sem o salto nos valores baixos de um map() linear.
+//
+// A tabela é calculada em tempo de compilação e só com inteiros; em tempo de
+// execução é uma leitura de vetor. Não depende do Arduino.h, então também
+// compila no host.
+
+#include <stdint.h>
+
+#define LEDGAMMA_STEPS 100 // Maior valor aceito pelo SET_LED
+
+template <unsigned Bits>
+class LedGammaTable {
+public:
+  static_assert(Bits >= 1 && Bits <= 16, "resolução do PWM deve ser de 1 a 16 bits");
+  static constexpr uint32_t kMaxDuty = (1u << Bits) - 1;
+
+  constexpr LedGammaTable() : duty_() {
+    for (uint32_t l = 0; l <= LEDGAMMA_STEPS; l++) {
+      // Y = ((L + 16) / 116)^3, ou Y = L / 903.3 até L* = 8
+      uint64_t num = (uint64_t)kMaxDuty * (l + 16) * (l + 16) * (l + 16);
+      uint64_t den = 116ull * 116 * 116;
+      if (l <= 8) {
+        num = (uint64_t)kMaxDuty * l * 10;
+        den = 9033;
+      }
+      duty_[l] = (uint32_t)((num + den / 2) / den);
+    }
+  }
+
+  // Duty cycle para um brilho de 0 a LEDGAMMA_STEPS (valores fora são limitados)
+  constexpr uint32_t operator[](int value) const {
+    return duty_[value < 0 ? 0 : value > LEDGAMMA_STEPS ? LEDGAMMA_STEPS : value];
+  }
+
+private:
+  uint32_t duty_[LEDGAMMA_STEPS + 1];
+};
+
+#endif
@@ -0,0 +1,30 @@
+#include "linebuffer.h"
+
+#include <string.h>
+
+void LineBuffer::feed(const char *data, size_t len, LineHandler handler, void *ctx) {
+  for (size_t i = 0; i < len; i++) {
+    char c = data[i];
+
+    if (c != '\n') {
+      if (len_ < sizeof(buf_))
+        buf_[len_++] = c;
+      else
+        overflow_ = true; // Descarta o resto até o fim da linha
+      continue;
+    }
+
+    CommandLine line;
+    size_t n = len_;
+    if (n > 0 && buf_[n - 1] == '\r' && !overflow_)
+      n--;
+    memcpy(line.text, buf_, n);
+    line.text[n] = '\0';
+    line.len = (unsigned char)n;
+    line.overflow = overflow_;
+    handler(line, ctx);
+
+    len_ = 0;
+    overflow_ = false;
+  }
+}
@@ -0,0 +1,35 @@
+#ifndef SMARTLAMP_LINEBUFFER_H
+#define SMARTLAMP_LINEBUFFER_H
+
+// Monta linhas de comando a partir dos bytes recebidos pela serial, num
+// buffer de tamanho fixo (sem String nem heap). Não depende do Arduino.h,
+// então também compila no host.
+
+#include <stddef.h>
+
+#define LINEBUFFER_MAX 64 // Maior linha de comando aceita, sem o '\n'
+
+// Linha completa, já sem o '\n' (e sem o '\r' de um "\r\n")
+struct CommandLine {
+  char text[LINEBUFFER_MAX + 1];
+  unsigned char len;
+  bool overflow; // A linha passou de LINEBUFFER_MAX; text tem só o começo
+};
+
+class LineBuffer {
+public:
+  typedef void (*LineHandler)(const CommandLine &line, void *ctx);
+
+  LineBuffer() : len_(0), overflow_(false) {}
+
+  // Consome data[0..len) e chama handler para cada linha completada. Bytes
+  // depois do último '\n' ficam guardados para a próxima chamada.
+  void feed(const char *data, size_t len, LineHandler handler, void *ctx);
+
+private:
+  char buf_[LINEBUFFER_MAX];
+  size_t len_;
+  bool overflow_;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef SMARTLAMP_PERFSTATS_H
+#define SMARTLAMP_PERFSTATS_H
+
+// Contadores de desempenho do firmware: quantas vezes um trecho rodou, a
+// média, o máximo e um histograma da duração, em ciclos de CPU. Cada
+// PerfTimer deve ter um único escritor; quem lê (o GET_STATS) pode ver os
+// campos de momentos um pouco diferentes, o que não importa para
+// diagnóstico. Não depende do Arduino.h, então também compila no host.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Faixa i do histograma: menos de 4096 * 4^i ciclos (a 240 MHz, 17 us, 68 us,
+// 273 us, 1,1 ms, 4,4 ms, 17 ms e 70 ms); a última recebe o resto
+#define PERFSTATS_BUCKETS 8
+#define PERFSTATS_FIRST_SHIFT 12
+
+class PerfTimer {
+public:
+  PerfTimer() : count_(0), max_(0), total_(0), hist_() {}
+
+  void add(uint32_t cycles) {
+    count_++;
+    total_ += cycles;
+    if (cycles > max_)
+      max_ = cycles;
+    hist_[bucketOf(cycles)]++;
+  }
+
+  uint32_t count() const { return count_; }
+  uint32_t max() const { return max_; }
+  uint32_t avg() const { return count_ ? (uint32_t)(total_ / count_) : 0; }
+  uint32_t bucket(size_t i) const { return hist_[i]; }
+
+  static size_t bucketOf(uint32_t cycles) {
+    size_t b = 0;
+    for (cycles >>= PERFSTATS_FIRST_SHIFT; cycles && b < PERFSTATS_BUCKETS - 1; cycles >>= 2)
+      b++;
+    return b;
+  }
+
+private:
+  uint32_t count_, max_;
+  uint64_t total_;
+  uint32_t hist_[PERFSTATS_BUCKETS];
+};
+
+#endif
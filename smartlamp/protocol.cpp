@@ -0,0 +1,98 @@
+#include "protocol.h"
+
+#include <limits.h>
+#include <string.h>
+
+static bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+static bool isAlpha(char c) { return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'); }
+
+// Converte o início de s[0..len) em inteiro, ignorando o que vier depois dos
+// dígitos (mesmo comportamento de String::toInt, mas saturando em overflow).
+// *valid diz se havia ao menos um dígito; sem ele o resultado é 0.
+static long parseLong(const char *s, size_t len, bool *valid) {
+  size_t i = 0;
+  bool negative = false;
+  unsigned long acc = 0;
+  const unsigned long limit = (unsigned long)LONG_MAX + 1;
+
+  while (i < len && isSpace(s[i])) i++;
+  if (i < len && (s[i] == '+' || s[i] == '-')) {
+    negative = (s[i] == '-');
+    i++;
+  }
+  *valid = i < len && isDigit(s[i]);
+  for (; i < len && isDigit(s[i]); i++) {
+    unsigned long digit = (unsigned long)(s[i] - '0');
+    if (acc > (limit - digit) / 10) {
+      acc = limit;
+      break;
+    }
+    acc = acc * 10 + digit;
+  }
+
+  if (negative)
+    return acc >= limit ? LONG_MIN : -(long)acc;
+  return acc >= limit ? LONG_MAX : (long)acc;
+}
+
+bool protocolParse(const char *line, size_t len, ProtocolCommand *cmd) {
+  size_t begin = 0, end = len, nameEnd;
+
+  // Remove espaços e quebras de linha das pontas (como String::trim)
+  while (begin < end && isSpace(line[begin])) begin++;
+  while (end > begin && isSpace(line[end - 1])) end--;
+  if (begin == end)
+    return false;
+
+  // Se houver argumento no comando, separe comando e valor
+  nameEnd = begin;
+  while (nameEnd < end && line[nameEnd] != ' ') nameEnd++;
+  if (nameEnd - begin > PROTOCOL_MAX_NAME)
+    return false;
+
+  memcpy(cmd->name, line + begin, nameEnd - begin);
+  cmd->name[nameEnd - begin] = '\0';
+  cmd->word[0] = '\0';
+  cmd->valueCount = 0;
+  cmd->valuesValid = true;
+  cmd->valueValid = false;
+  cmd->value = 0;
+  cmd->hasValue = nameEnd < end;
+  if (!cmd->hasValue)
+    return true;
+
+  // Argumento em forma de palavra: "SUBSCRIBE LDR 100"
+  size_t arg = nameEnd + 1;
+  if (arg < end && isAlpha(line[arg])) {
+    size_t wordEnd = arg;
+    while (wordEnd < end && line[wordEnd] != ' ') wordEnd++;
+    if (wordEnd - arg <= PROTOCOL_MAX_NAME) {
+      memcpy(cmd->word, line + arg, wordEnd - arg);
+      cmd->word[wordEnd - arg] = '\0';
+    }
+    arg = wordEnd;
+
+    // Depois da palavra pode vir uma lista: "SET_REPORT LDR 10 5 100 60000"
+    size_t pos = arg;
+    while (pos < end && cmd->valueCount < PROTOCOL_MAX_VALUES) {
+      while (pos < end && line[pos] == ' ') pos++;
+      if (pos == end)
+        break;
+      size_t tokenEnd = pos;
+      while (tokenEnd < end && line[tokenEnd] != ' ') tokenEnd++;
+      bool valid;
+      cmd->values[cmd->valueCount++] = parseLong(line + pos, tokenEnd - pos, &valid);
+      cmd->valuesValid = cmd->valuesValid && valid;
+      pos = tokenEnd;
+    }
+    // "SET_LED abc 50" não é um SET_LED 50: o argumento não é numérico
+    return true;
+  }
+  cmd->value = parseLong(line + arg, end - arg, &cmd->valueValid);
+  return true;
+}
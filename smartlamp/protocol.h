@@ -0,0 +1,128 @@
+#ifndef SMARTLAMP_PROTOCOL_H
+#define SMARTLAMP_PROTOCOL_H
+
+// Parser dos comandos recebidos pela serial ("SET_LED 50", "GET_LDR", ...).
+// Não depende do Arduino.h, então também compila no host.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define PROTOCOL_MAX_NAME 15  // Maior nome de comando aceito
+#define PROTOCOL_MAX_VALUES 4 // Números lidos depois de uma palavra
+
+// Comando recebido pela serial, já separado em nome e argumento
+struct ProtocolCommand {
+  char name[PROTOCOL_MAX_NAME + 1];
+  char word[PROTOCOL_MAX_NAME + 1]; // Palavra antes do número ("SUBSCRIBE LDR 100"), ou vazio
+  long value;    // Argumento numérico (0 se ausente ou inválido, como String::toInt)
+  bool hasValue; // Se havia algo depois do nome do comando
+  bool valueValid; // Se o argumento começa com um número ([+-] e dígitos)
+  long values[PROTOCOL_MAX_VALUES]; // Números depois da palavra, se houver uma
+  uint8_t valueCount;
+  bool valuesValid; // Se todos os values começam com um número
+};
+
+// Separa a linha line[0..len) em nome e argumento. Se o argumento começar
+// com uma letra, a primeira palavra vai para word e os números separados por
+// espaço depois dela vão para values. Retorna false se a linha estiver vazia
+// ou o nome não couber em ProtocolCommand::name.
+bool protocolParse(const char *line, size_t len, ProtocolCommand *cmd);
+
+// Tipo de argumento que um comando espera
+enum ProtocolArg : uint8_t {
+  PROTOCOL_ARG_NONE, // Argumento ignorado, se houver
+  PROTOCOL_ARG_INT,  // Inteiro obrigatório dentro de [min, max]
+  PROTOCOL_ARG_WORD_INT, // Palavra seguida de inteiros; o primeiro dentro de [min, max]
+};
+
+// Uma entrada da tabela de comandos. Comandos PROTOCOL_ARG_WORD_INT usam
+// wordHandler no lugar de handler e validam os números depois do primeiro.
+struct ProtocolCommandSpec {
+  const char *name;
+  ProtocolArg arg;
+  long min, max;
+  void (*handler)(long value);
+  void (*wordHandler)(const char *word, const long *values, uint8_t count);
+};
+
+// Diz se o argumento de cmd está de acordo com o que spec espera
+inline bool protocolCheckArg(const ProtocolCommandSpec &spec, const ProtocolCommand &cmd) {
+  if (spec.arg == PROTOCOL_ARG_NONE)
+    return true;
+  if (spec.arg == PROTOCOL_ARG_WORD_INT)
+    return cmd.word[0] != '\0' && cmd.valueCount > 0 && cmd.valuesValid &&
+           cmd.values[0] >= spec.min && cmd.values[0] <= spec.max;
+  return cmd.valueValid && cmd.value >= spec.min && cmd.value <= spec.max;
+}
+
+constexpr size_t protocolStrlen(const char *s) {
+  size_t n = 0;
+  while (s[n]) n++;
+  return n;
+}
+
+// FNV-1a com semente, usado pela tabela de comandos
+constexpr uint32_t protocolHash(const char *s, size_t len, uint32_t seed) {
+  uint32_t h = 2166136261u ^ seed;
+  for (size_t i = 0; i < len; i++) {
+    h ^= (uint8_t)s[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+// Tabela de comandos com hash perfeito calculado em tempo de compilação:
+// o construtor procura uma semente em que cada nome cai numa posição
+// diferente, então a busca é um hash, uma posição e uma comparação. Para
+// adicionar um comando basta uma entrada nova no vetor passado para ela.
+template <size_t N>
+class ProtocolTable {
+public:
+  static constexpr size_t kSlots = N <= 4 ? 8 : N <= 8 ? 16 : N <= 16 ? 32 : 64;
+  static_assert(N < kSlots && N <= 127, "tabela de comandos grande demais");
+
+  constexpr explicit ProtocolTable(const ProtocolCommandSpec (&specs)[N])
+      : specs_(specs), seed_(0), perfect_(false), slots_() {
+    for (uint32_t seed = 1; seed < 4096 && !perfect_; seed++) {
+      perfect_ = true;
+      for (size_t s = 0; s < kSlots; s++) slots_[s] = -1;
+      for (size_t i = 0; i < N && perfect_; i++) {
+        size_t slot = slotOf(specs[i].name, protocolStrlen(specs[i].name), seed);
+        if (slots_[slot] >= 0)
+          perfect_ = false;
+        else
+          slots_[slot] = (int8_t)i;
+      }
+      seed_ = seed;
+    }
+  }
+
+  // Falso se algum nome se repete (ou nenhuma semente serviu)
+  constexpr bool perfect() const { return perfect_; }
+
+  const ProtocolCommandSpec *find(const char *name, size_t len) const {
+    int8_t i = slots_[slotOf(name, len, seed_)];
+    if (i < 0)
+      return nullptr;
+    const ProtocolCommandSpec &spec = specs_[i];
+    if (strncmp(spec.name, name, len) != 0 || spec.name[len] != '\0')
+      return nullptr;
+    return &spec;
+  }
+
+private:
+  const ProtocolCommandSpec *specs_;
+  uint32_t seed_;
+  bool perfect_;
+  int8_t slots_[kSlots];
+
+  // Os bits baixos do FNV-1a só dependem dos bits baixos da semente, então a
+  // posição mistura também a metade de cima do hash
+  static constexpr size_t slotOf(const char *name, size_t len, uint32_t seed) {
+    uint32_t h = protocolHash(name, len, seed);
+    return (h ^ (h >> 16)) & (kSlots - 1);
+  }
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef SMARTLAMP_SEQLOCK_H
+#define SMARTLAMP_SEQLOCK_H
+
+// Retrato protegido por seqlock: um único escritor publica valores novos sem
+// esperar ninguém, e os leitores copiam o valor e tentam de novo se o
+// escritor mexeu nele no meio da cópia. Serve para o retrato dos sensores,
+// escrito pela tarefa de um núcleo e lido pelo protocolo no outro, sem
+// seção crítica entre os dois.
+//
+// O leitor fica em espera ativa enquanto uma escrita está em andamento, então
+// o escritor não pode ser interrompido por um leitor de prioridade maior no
+// mesmo núcleo (a escrita é só uma cópia, de qualquer forma).
+// Não depende do Arduino.h, então também compila no host.
+
+#include <atomic>
+#include <stdint.h>
+
+template <typename T>
+class Seqlock {
+public:
+  explicit Seqlock(const T &initial) : seq_(0), value_(initial) {}
+
+  // Só o escritor
+  void write(const T &value) {
+    uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed); // Ímpar: escrita em andamento
+    std::atomic_thread_fence(std::memory_order_release);
+    value_ = value;
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  T read() const {
+    T copy;
+    uint32_t before, after;
+    do {
+      before = seq_.load(std::memory_order_acquire);
+      copy = value_;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = seq_.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return copy;
+  }
+
+private:
+  std::atomic<uint32_t> seq_;
+  T value_;
+};
+
+#endif
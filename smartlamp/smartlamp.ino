@@ -1,139 +1,1062 @@
 #include <DHT.h>
+#include <DHT_Bus.h>
+
+#include "history.h"
+#include "intfmt.h"
+#include "ldrfilter.h"
+#include "ledgamma.h"
+#include "linebuffer.h"
+#include "perfstats.h"
+#include "protocol.h"
+#include "seqlock.h"
+#include "spsc.h"
+
+// Porta usada para falar com o driver. Nas placas com conversor CP2102 é a
+// Serial (UART0); em placas com USB nativo (ESP32-S3/C3) defina
+// SMARTLAMP_USB_NATIVE para usar a USBSerial, que não passa pela UART e
+// responde no ritmo dos frames USB.
+#ifdef SMARTLAMP_USB_NATIVE
+#define LampSerial USBSerial
+#else
+#define LampSerial Serial
+#endif
 
 int ledPin = 4;
 int ledValue = 10;
+
+// PWM do LED pelo LEDC. A frequência vezes 2^bits não pode passar do relógio
+// do LEDC (80 MHz no APB): 12 bits a 19 kHz fica acima do audível e sem
+// cintilação; para 16 bits a frequência tem que ficar abaixo de ~1,2 kHz.
+#ifndef LED_PWM_BITS
+#define LED_PWM_BITS 12
+#endif
+#ifndef LED_PWM_FREQ
+#define LED_PWM_FREQ 19000
+#endif
+
+constexpr LedGammaTable<LED_PWM_BITS> ledGamma;
 #define DHTPIN 15  // Pino onde o DHT11 está conectado
 #define DHTTYPE DHT11
 
 DHT dht(DHTPIN, DHTTYPE);  //Instanciando o DHT para dht
 
+// Sensores DHT, um por zona da luminária, lidos juntos pelo dhtBus: os sinais
+// de início saem ao mesmo tempo e, com RMT, as respostas são capturadas em
+// paralelo, então todas as zonas custam mais ou menos uma leitura. A zona 0 é
+// a do GET_DHT, do histórico e das assinaturas; as outras, só pelo GET_ZONE.
+// Para outra zona, acrescente aqui um DHT com o pino dela.
+DHT *const dhtZones[] = { &dht };
+#define DHT_ZONES (sizeof(dhtZones) / sizeof(dhtZones[0]))
+DHT_Bus dhtBus(dhtZones, DHT_ZONES);
+
 int ldrPin = 2;
 //float temp = 0;
 //float hum = 0;
 // Faça testes no sensor ldr para encontrar o valor maximo e atribua a variável ldrMax
 int ldrMax = 4095;
 
+// Com SET_STAMP 1 toda resposta termina em " @<amostra>,<resposta>": o
+// micros() de quando o sensor foi lido e o de quando a resposta foi montada.
+// O driver usa o segundo para estimar o relógio do ESP32 e converte o
+// primeiro para o relógio do host. Desligado por padrão, para não confundir
+// drivers antigos, que pegam o último número da linha.
+bool stampEnabled = false;
+
+// Com SET_FORMAT 1 temperatura, umidade e índice de calor saem como inteiros
+// em escala fixa (centésimos de °C e décimos de %), montados sem vsnprintf
+// nem ponto flutuante e sem o arredondamento do "%.1f". Desligado por padrão
+// pelo mesmo motivo do SET_STAMP.
+bool fixedFormat = false;
+
+// Divisão entre os núcleos: o loop (protocolo serial) roda no núcleo do
+// Arduino e as tarefas dos sensores e do LED no outro, então uma leitura
+// lenta do DHT ou do ADC não atrasa a resposta a um comando. Os dois lados
+// só conversam por filas SPSC (comandos) e por retratos com seqlock
+// (leituras), sem seções críticas. Em chips de um núcleo só (ESP32-C3/S2)
+// tudo fica no mesmo núcleo.
+#define PROTOCOL_CORE ARDUINO_RUNNING_CORE
+#if CONFIG_FREERTOS_UNICORE
+#define SENSOR_CORE 0
+#else
+#define SENSOR_CORE (1 - ARDUINO_RUNNING_CORE)
+#endif
+
+// Leitura da serial por evento: o callback de recepção monta as linhas num
+// buffer fixo, as coloca numa fila e acorda o loop. Vários comandos
+// recebidos de uma vez viram várias entradas na fila, e nada disso usa o
+// heap. O callback é o único produtor e o loop o único consumidor.
+#define SERIAL_RX_BUFFER 1024 // Buffer de recepção do driver da UART
+#define COMMAND_QUEUE_LEN 8   // Comandos esperando o loop
+
+LineBuffer lineBuffer;
+SpscQueue<CommandLine, COMMAND_QUEUE_LEN> commandQueue;
+TaskHandle_t loopTaskHandle;
+
+// Pedidos do protocolo para a ioTask, no outro núcleo, que é quem mexe no
+// LED e no LDR
+#define ACTUATOR_QUEUE_LEN 8
+
+enum ActuatorOp : uint8_t {
+  ACT_SET_LED,     // Brilho de 0 a 100
+  ACT_LDR_FILTER,  // Novo emaShift do filtro do LDR
+  ACT_LDR_CAPTURE, // Começa uma captura bruta de n amostras
+};
+
+struct ActuatorCommand {
+  ActuatorOp op;
+  int32_t value;
+};
+
+SpscQueue<ActuatorCommand, ACTUATOR_QUEUE_LEN> actuatorQueue;
+
+// Contadores da leitura serial, só incrementados pelo callback de recepção
+volatile uint32_t serialLines = 0;     // Linhas recebidas
+volatile uint32_t serialOverflows = 0; // Linhas maiores que LINEBUFFER_MAX
+volatile uint32_t serialDrops = 0;     // Linhas perdidas com a fila cheia
+
+// Tempo gasto em cada parte do firmware, em ciclos de CPU (ver perfstats.h),
+// para o GET_STATS. Cada contador só é escrito pela tarefa que roda o trecho.
+PerfTimer loopTimer;     // Loop acordado (sem a espera por comandos)
+PerfTimer rxTimer;       // onSerialReceive, na tarefa de eventos da UART
+PerfTimer parseTimer;    // Parser e busca na tabela
+PerfTimer dhtReadTimer;  // DHT::startRead e DHT::poll, na dhtTask
+PerfTimer ledTimer;      // ledUpdate, na ioTask
+
+// Mede o trecho do construtor até o fim do escopo. O contador de ciclos é de
+// cada núcleo, então só serve em tarefas fixas num núcleo: o loop, a dhtTask
+// e a ioTask.
+struct CycleScope {
+  PerfTimer &timer;
+  uint32_t start;
+
+  CycleScope(PerfTimer &t) : timer(t), start(ESP.getCycleCount()) {}
+  ~CycleScope() { timer.add(ESP.getCycleCount() - start); }
+};
+
+// Mesma medida pelo esp_timer, que é o mesmo nos dois núcleos, para tarefas
+// sem núcleo fixo como a de eventos da UART, que o FreeRTOS pode migrar no
+// meio do trecho. A resolução é de 1 us, convertida para ciclos para ficar na
+// unidade dos outros contadores.
+struct TimerScope {
+  PerfTimer &timer;
+  int64_t start;
+
+  TimerScope(PerfTimer &t) : timer(t), start(esp_timer_get_time()) {}
+  ~TimerScope() { timer.add((uint32_t)(esp_timer_get_time() - start) * ESP.getCpuFreqMHz()); }
+};
+
+// Amostragem do DHT em segundo plano: uma tarefa lê o sensor no próprio
+// ritmo (a leitura bloqueia ~25 ms, parte com interrupções desligadas) e
+// publica o último valor; GET_TEMP/GET_HUM só copiam esse retrato.
+#define DHT_PERIOD_MS 2000       // O DHT11 não aceita leituras mais frequentes
+#define DHT_MAX_AGE_MS 10000     // Mais velho que isso, o valor não é entregue
+#define DHT_RETRIES 1            // Nova tentativa após uma falha, depois do intervalo mínimo
+#define DHT_TASK_STACK 3072
+
+struct DhtSnapshot {
+  float temp;
+  float hum;
+  float heatIndex;        // Índice de calor em °C, calculado junto com a leitura
+  int16_t tempCenti;      // Os mesmos valores em escala fixa (SET_FORMAT 1),
+  uint16_t humMille;      // convertidos uma vez na dhtTask
+  int16_t heatIndexCenti;
+  uint32_t sampledMicros; // micros() da última leitura boa
+  bool valid;             // Já houve alguma leitura boa
+  bool lastOk;            // A leitura mais recente passou no checksum
+  uint32_t failures;      // Leituras que falharam desde o início
+};
+
+// Todas as zonas num retrato só, publicado a cada leitura do dhtBus
+struct DhtZoneSnapshots {
+  DhtSnapshot zone[DHT_ZONES];
+};
+
+Seqlock<DhtZoneSnapshots> dhtSnapshots(DhtZoneSnapshots{});
+StaticTask_t dhtTaskState;
+StackType_t dhtTaskStack[DHT_TASK_STACK];
+
+// Amostragem contínua do LDR: o ADC converte sozinho (DMA) a LDR_SAMPLE_HZ e
+// entrega a média de cada LDR_DECIMATION conversões; a ioTask passa essas
+// médias pelo LdrFilter e publica o resultado, então o GET_LDR não espera o
+// ADC. A mesma tarefa aplica os pedidos da actuatorQueue. O modo contínuo só funciona em pinos do ADC1; em outro pino (o GPIO2
+// do ESP32 clássico é ADC2) a tarefa cai para analogRead no mesmo ritmo.
+#define LDR_SAMPLE_HZ 20000         // Mínimo do modo contínuo no ESP32
+#define LDR_DECIMATION 200          // -> 100 amostras/s para o filtro
+#define LDR_CAPTURE_DECIMATION 20   // -> 1000 amostras/s na captura bruta
+#define LDR_CAPTURE_MAX 512
+#define LDR_MEDIAN 5
+#define LDR_EMA_SHIFT 3
+#define IO_TASK_STACK 3072
+
+struct LdrSnapshot {
+  int32_t raw;            // Última média do ADC, sem filtro
+  int32_t filtered;
+  uint32_t sampledMicros;
+};
+
+LdrFilter ldrFilter(LDR_MEDIAN, LDR_EMA_SHIFT);
+Seqlock<LdrSnapshot> ldrSnapshot(LdrSnapshot{ 0, 0, 0 });
+TaskHandle_t ioTaskHandle;
+StaticTask_t ioTaskState;
+StackType_t ioTaskStack[IO_TASK_STACK];
+bool ldrContinuous = false;
+
+// Captura bruta: LDR_CAPTURE n pede n amostras sem filtro, LDR_DUMP as envia.
+// Os volatile são escritos só pela ioTask; ldrCaptureRequests só pelo loop.
+uint16_t ldrCapture[LDR_CAPTURE_MAX];
+uint32_t ldrCaptureRequests = 0;         // Capturas pedidas
+volatile uint32_t ldrCaptureStarted = 0; // Capturas já começadas
+volatile uint16_t ldrCaptureLen = 0;     // Amostras já capturadas
+volatile uint16_t ldrCaptureTarget = 0;
+volatile uint32_t ldrCaptureHz = 0;      // Taxa da última captura
+
+// Assinaturas (SUBSCRIBE <sensor> <periodo_ms>): o loop envia sozinho uma
+// linha "EVT <sensor> <valores>" a cada período, sem um comando por amostra.
+// As linhas saem do mesmo loop que responde os comandos, então nunca se
+// misturam com uma resposta.
+//
+// Com SET_REPORT a assinatura passa a relatar só mudanças: a cada período o
+// valor é lido, mas só é enviado se andou pelo menos o limiar absoluto ou
+// percentual desde o último envio, respeitando um intervalo mínimo entre
+// envios e um máximo (para o host saber que o ESP32 continua vivo).
+#define SUBSCRIBE_MIN_MS 10
+#define SUBSCRIBE_MAX_MS 3600000
+#define REPORT_MAX_ABS 10000  // Em décimos da unidade do sensor
+
+// Valores de uma leitura em décimos (LDR e LED em 0..1000, temperatura em
+// décimos de °C, umidade em décimos de %), para a comparação com o limiar
+struct SubscriptionSample {
+  int32_t values[2];
+  uint32_t sampledMicros;
+  DhtSnapshot dht;  // Só para o DHT
+};
+
+struct Subscription {
+  const char *sensor;
+  uint8_t count;  // Quantos valores de SubscriptionSample o sensor usa
+  bool (*read)(SubscriptionSample *sample);
+  void (*emit)(const SubscriptionSample &sample);
+  uint32_t periodMs;  // 0 = sem assinatura
+  uint32_t nextMs;    // millis() da próxima leitura
+
+  // Relato por mudança (SET_REPORT); limiares zerados = envia toda leitura
+  uint16_t deadbandAbs;  // Mesma unidade de SubscriptionSample
+  uint8_t deadbandPct;
+  uint32_t minMs, maxMs; // Entre envios; 0 = sem limite
+  int32_t lastValues[2]; // Último valor enviado
+  uint32_t lastReportMs;
+  bool reported;         // Já houve um envio desde o SUBSCRIBE/SET_REPORT
+};
+
+bool readLed(SubscriptionSample *sample);
+bool readLdr(SubscriptionSample *sample);
+bool readDht(SubscriptionSample *sample);
+void emitLed(const SubscriptionSample &sample);
+void emitLdr(const SubscriptionSample &sample);
+void emitDht(const SubscriptionSample &sample);
+
+Subscription subscriptions[] = {
+  { "LED", 1, readLed, emitLed },
+  { "LDR", 1, readLdr, emitLdr },
+  { "DHT", 2, readDht, emitDht },
+};
+const size_t subscriptionCount = sizeof(subscriptions) / sizeof(subscriptions[0]);
+
+// Histórico (ver history.h): o loop grava um registro a cada
+// HISTORY_PERIOD_MS e GET_HISTORY <segundos> devolve os registros desse
+// intervalo até agora, para o host preencher o que perdeu.
+#define HISTORY_PERIOD_MS 10000
+#define HISTORY_LEN 4096            // 48 KB, ~11 h de histórico
+#define HISTORY_LINE_RECORDS 16     // Registros por linha "HIS"
+#define HISTORY_MAX_AGE_S 2000000   // Cabe em ms de 32 bits
+
+HistoryRing<HISTORY_LEN> history;
+uint32_t historyNextMs = 0;
+
 void setup() {
-  Serial.begin(115200);
+  loopTaskHandle = xTaskGetCurrentTaskHandle();  // setup() e loop() rodam na mesma tarefa
+
+  LampSerial.setRxBufferSize(SERIAL_RX_BUFFER);  // Precisa vir antes do begin()
+  LampSerial.begin(115200);
+#ifdef SMARTLAMP_USB_NATIVE
+  LampSerial.onEvent(ARDUINO_HW_CDC_RX_EVENT, onUsbEvent);
+#else
+  LampSerial.onReceive(onSerialReceive);
+#endif
 
-  pinMode(ledPin, OUTPUT);
+  ledcAttach(ledPin, LED_PWM_FREQ, LED_PWM_BITS);
   pinMode(ldrPin, INPUT);
   pinMode(DHTPIN, INPUT);
 
-  ledUpdate();
+  ledUpdate(ledValue);
 
-  dht.begin();
+  dhtBus.begin();
+  for (size_t i = 0; i < DHT_ZONES; i++) {
+    dhtZones[i]->setRetries(DHT_RETRIES);
+  }
+  xTaskCreateStaticPinnedToCore(dhtTask, "dht", DHT_TASK_STACK, NULL, 1, dhtTaskStack, &dhtTaskState, SENSOR_CORE);
+  ioTaskHandle = xTaskCreateStaticPinnedToCore(ioTask, "io", IO_TASK_STACK, NULL, 1, ioTaskStack, &ioTaskState, SENSOR_CORE);
+}
+
+// Chamado pelo driver do ADC (em ISR) quando um lote de conversões termina
+void ARDUINO_ISR_ATTR onLdrConversion() {
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(ioTaskHandle, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+// Manda um pedido para a ioTask. Retorna false com a fila cheia.
+bool actuatorSend(ActuatorOp op, int32_t value) {
+  if (!actuatorQueue.push(ActuatorCommand{ op, value })) {
+    return false;
+  }
+  xTaskNotifyGive(ioTaskHandle);
+  return true;
+}
+
+// (Re)inicia o modo contínuo fazendo a média de 'decimation' conversões
+bool ldrStartContinuous(uint32_t decimation) {
+  const uint8_t pins[] = { (uint8_t)ldrPin };
+
+  if (ldrContinuous) {
+    analogContinuousStop();
+    analogContinuousDeinit();
+    ldrContinuous = false;
+  }
+  if (!analogContinuous(pins, 1, decimation, LDR_SAMPLE_HZ, onLdrConversion)) {
+    return false;
+  }
+  ldrContinuous = analogContinuousStart();
+  return ldrContinuous;
+}
+
+// Publica uma amostra: passa pelo filtro e vai para a captura, se houver
+void ldrSample(int32_t raw, bool toFilter) {
+  uint32_t now = micros();
+  int32_t filtered = toFilter ? ldrFilter.add(raw) : ldrFilter.value();
+
+  if (ldrCaptureLen < ldrCaptureTarget) {
+    ldrCapture[ldrCaptureLen] = raw;
+    ldrCaptureLen = ldrCaptureLen + 1;
+  }
+
+  // Só esta tarefa escreve no retrato, então pode partir do valor atual
+  LdrSnapshot snap = ldrSnapshot.read();
+  snap.raw = raw;
+  if (toFilter) {
+    snap.filtered = filtered;
+    snap.sampledMicros = now;
+  }
+  ldrSnapshot.write(snap);
+}
+
+// Tarefa de E/S no núcleo dos sensores: LDR (ADC e filtro) e os pedidos da
+// actuatorQueue (LED, filtro e captura). Acorda com cada lote do ADC ou
+// com um pedido novo.
+void ioTask(void *arg) {
+  const TickType_t readPeriod = pdMS_TO_TICKS(1000 * LDR_DECIMATION / LDR_SAMPLE_HZ);
+  TickType_t nextRead = xTaskGetTickCount();
+  uint32_t decimation = LDR_DECIMATION;
+  uint32_t skip = 0;
+
+  ldrContinuous = ldrStartContinuous(decimation);
+
+  for (;;) {
+    ActuatorCommand act;
+    while (actuatorQueue.pop(&act)) {
+      switch (act.op) {
+        case ACT_SET_LED:
+          ledUpdate(act.value);
+          break;
+        case ACT_LDR_FILTER:
+          ldrFilter.setEmaShift(act.value);
+          break;
+        case ACT_LDR_CAPTURE:
+          // No modo contínuo, sobe a taxa enquanto a captura durar
+          ldrCaptureLen = 0;
+          ldrCaptureTarget = act.value;
+          if (ldrContinuous && ldrStartContinuous(LDR_CAPTURE_DECIMATION)) {
+            decimation = LDR_CAPTURE_DECIMATION;
+          }
+          ldrCaptureHz = LDR_SAMPLE_HZ / (ldrContinuous ? decimation : LDR_DECIMATION);
+          ldrCaptureStarted = ldrCaptureStarted + 1;
+          break;
+      }
+    }
+    if (decimation != LDR_DECIMATION && ldrCaptureLen >= ldrCaptureTarget) {
+      ldrStartContinuous(LDR_DECIMATION);
+      decimation = LDR_DECIMATION;
+    }
+
+    if (!ldrContinuous) {
+      // analogRead no ritmo que o filtro esperaria do modo contínuo; um
+      // pedido que chega no meio acorda a tarefa sem adiantar a leitura
+      TickType_t now = xTaskGetTickCount();
+      if ((int32_t)(now - nextRead) >= 0) {
+        ldrSample(analogRead(ldrPin), true);
+        nextRead = now + readPeriod;
+      }
+      // Com sinal: se o tick já passou de nextRead, a diferença sem sinal
+      // daria uma espera quase infinita e o LDR pararia de ser lido
+      int32_t left = (int32_t)(nextRead - xTaskGetTickCount());
+      ulTaskNotifyTake(pdTRUE, left > 0 ? left : 0);
+      continue;
+    }
+
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    adc_continuous_data_t *data = NULL;
+    if (analogContinuousRead(&data, 0) && data != NULL) {
+      // Na captura o filtro continua recebendo só 100 amostras/s
+      bool toFilter = decimation == LDR_DECIMATION || ++skip >= LDR_DECIMATION / LDR_CAPTURE_DECIMATION;
+      if (toFilter) {
+        skip = 0;
+      }
+      ldrSample(data[0].avg_read_raw, toFilter);
+    }
+  }
+}
+
+void dhtTask(void *arg) {
+  TickType_t last = xTaskGetTickCount();
+
+  for (;;) {
+    // Leitura sem bloquear de todas as zonas: a tarefa dorme entre as fases
+    // do sinal de início e durante a captura, e o dht_read do GET_STATS soma
+    // só o tempo de CPU gasto dentro da biblioteca
+    uint32_t start = ESP.getCycleCount();
+    dhtBus.startRead();
+    uint32_t cycles = ESP.getCycleCount() - start;
+    for (;;) {
+      vTaskDelay(1);
+      start = ESP.getCycleCount();
+      uint8_t state = dhtBus.poll();
+      cycles += ESP.getCycleCount() - start;
+      if (state != DHT_READ_BUSY) {
+        break;
+      }
+    }
+    dhtReadTimer.add(cycles);
+
+    dht_reading_t readings[DHT_ZONES];
+    dhtBus.getReadings(readings);
+    DhtZoneSnapshots snaps = dhtSnapshots.read();
+    for (size_t i = 0; i < DHT_ZONES; i++) {
+      const dht_reading_t &reading = readings[i];
+      DhtSnapshot &snap = snaps.zone[i];
+
+      if (reading.valid) {
+        float heatIndex = dhtZones[i]->computeHeatIndex(reading.temperature, reading.humidity, false);
+        snap.temp = reading.temperature;
+        snap.hum = reading.humidity;
+        snap.heatIndex = heatIndex;
+        snap.tempCenti = lroundf(reading.temperature * 100);
+        snap.humMille = lroundf(reading.humidity * 10);
+        snap.heatIndexCenti = lroundf(heatIndex * 100);
+        snap.sampledMicros = reading.micros;
+        snap.valid = true;
+      }
+      else {
+        snap.failures++;
+      }
+      snap.lastOk = reading.valid;
+    }
+    dhtSnapshots.write(snaps);
+
+    // Uma nova tentativa atrasa o ciclo; a próxima leitura espera o período
+    // inteiro a partir de agora, e não a partir do início do ciclo atrasado
+    TickType_t now = xTaskGetTickCount();
+    if (now - last >= pdMS_TO_TICKS(DHT_PERIOD_MS)) {
+      last = now;
+    }
+    vTaskDelayUntil(&last, pdMS_TO_TICKS(DHT_PERIOD_MS));
+  }
+}
+
+// Copia o último retrato de uma zona. Retorna false se não há leitura boa recente.
+bool dhtGetZoneSnapshot(size_t zone, DhtSnapshot *out) {
+  *out = dhtSnapshots.read().zone[zone];
+  return out->valid && micros() - out->sampledMicros < DHT_MAX_AGE_MS * 1000UL;
+}
+
+bool dhtGetSnapshot(DhtSnapshot *out) {
+  return dhtGetZoneSnapshot(0, out);
 }
 
 // Função loop será executada infinitamente pelo ESP32
 void loop() {
-  //Obtenha os comandos enviados pela serial
+  //Espere os comandos enviados pela serial
   //e processe-os com a função processCommand
-  String command = waitSerial();
-  command.trim();
-  Serial.println(command);
-  processCommand(command);
-  ledUpdate();
-}
-
-String waitSerial() {
-  String str = "";
-  bool command = true;
-  while (command) {
-    if (Serial.available()) {
-      char c = Serial.read();
-      if (c == '\n') {
-        command = false;  // Fim da linha
-      }
-      str += c;  // Mais seguro que concat()
+  // Com a fila vazia, dorme até o queueLine avisar ou até o próximo envio
+  // de uma assinatura
+  CommandLine line;
+  bool received = commandQueue.pop(&line);
+  if (!received) {
+    TickType_t wait = subscriptionsWait();
+    TickType_t historyLeft = historyWait();
+    ulTaskNotifyTake(pdTRUE, historyLeft < wait ? historyLeft : wait);
+    received = commandQueue.pop(&line);
+  }
+  CycleScope scope(loopTimer);
+  subscriptionsEmit();
+  historyUpdate();
+  if (!received) {
+    return;
+  }
+
+  LampSerial.println(line.text);
+  if (line.overflow) {
+    respond(micros(), "ERR Line too long.");
+    return;
+  }
+  processCommand(line.text, line.len);
+}
+
+// Chamado pela tarefa de eventos da UART quando chegam bytes (não é ISR, mas
+// não deve bloquear): passa tudo pelo lineBuffer, que chama queueLine para
+// cada linha completa
+void onSerialReceive() {
+  TimerScope scope(rxTimer);
+  uint8_t chunk[64];
+  int n;
+
+  while ((n = LampSerial.available()) > 0) {
+    n = LampSerial.read(chunk, n < (int)sizeof(chunk) ? n : sizeof(chunk));
+    if (n <= 0) {
+      break;
     }
+    lineBuffer.feed((const char *)chunk, n, queueLine, NULL);
   }
-  return str;
 }
 
-void processCommand(String command) {
-  // compare o comando com os comandos possíveis e execute a ação correspondente
+#ifdef SMARTLAMP_USB_NATIVE
+void onUsbEvent(void *arg, esp_event_base_t base, int32_t id, void *data) {
+  onSerialReceive();
+}
+#endif
 
-  int spaceIndex = command.indexOf(' ');
-  String cmd, valueStr;
-  int value = 0;
+// Ticks até o próximo envio de uma assinatura (portMAX_DELAY se não há nenhuma)
+TickType_t subscriptionsWait() {
+  uint32_t now = millis();
+  TickType_t wait = portMAX_DELAY;
 
-  // Se houver argumento no comando, separe comando e valor
-  if (spaceIndex != -1) {
-    cmd = command.substring(0, spaceIndex);
-    valueStr = command.substring(spaceIndex + 1);
-    value = valueStr.toInt();
-  } 
-  else {
-    cmd = command;  // Comando sem argumentos
+  for (size_t i = 0; i < subscriptionCount; i++) {
+    if (!subscriptions[i].periodMs) {
+      continue;
+    }
+    int32_t left = (int32_t)(subscriptions[i].nextMs - now);
+    TickType_t ticks = left > 0 ? pdMS_TO_TICKS(left) : 0;
+    if (ticks < wait) {
+      wait = ticks;
+    }
   }
+  return wait;
+}
 
-  if (cmd == "SET_LED") {
+// Diz se a leitura deve ser enviada, conforme a configuração do SET_REPORT
+bool subscriptionShouldReport(const Subscription &sub, const SubscriptionSample &sample, uint32_t now) {
+  if (!sub.reported || (!sub.deadbandAbs && !sub.deadbandPct)) {
+    return true;
+  }
 
-    if (value >= 0 && value <= 100) {
-      ledValue = value;  // Atualiza a variável global
-      Serial.println("RES SET_LED 1");
+  uint32_t since = now - sub.lastReportMs;
+  if (sub.maxMs && since >= sub.maxMs) {
+    return true;
+  }
+  if (since < sub.minMs) {
+    return false;
+  }
+  for (uint8_t i = 0; i < sub.count; i++) {
+    int32_t last = sub.lastValues[i];
+    int32_t diff = abs(sample.values[i] - last);
+    if (sub.deadbandAbs && diff >= sub.deadbandAbs) {
+      return true;
     }
-    else {
-      Serial.println("RES SET_LED -1");
+    // Sem o diff > 0, um valor parado em zero passaria sempre no percentual
+    if (sub.deadbandPct && diff > 0 && diff * 100 >= (int32_t)sub.deadbandPct * abs(last)) {
+      return true;
     }
-  }  
-  else if (cmd == "GET_LED") {
-    
-    Serial.print("RES GET_LED ");
-    Serial.println(ledValue);
+  }
+  return false;
+}
 
-  } 
-  else if (cmd == "GET_LDR") {
+// Lê as assinaturas vencidas e envia as que devem ser relatadas. A próxima
+// leitura conta a partir da prevista, não de agora, para o período não
+// escorregar; se o loop se atrasou mais de um período inteiro, recomeça de
+// agora em vez de mandar uma rajada.
+void subscriptionsEmit() {
+  uint32_t now = millis();
+
+  for (size_t i = 0; i < subscriptionCount; i++) {
+    Subscription &sub = subscriptions[i];
+    if (!sub.periodMs || (int32_t)(sub.nextMs - now) > 0) {
+      continue;
+    }
+    SubscriptionSample sample;
+    if (sub.read(&sample) && subscriptionShouldReport(sub, sample, now)) {
+      sub.emit(sample);
+      memcpy(sub.lastValues, sample.values, sizeof(sub.lastValues));
+      sub.lastReportMs = now;
+      sub.reported = true;
+    }
+    sub.nextMs += sub.periodMs;
+    if ((int32_t)(sub.nextMs - now) <= 0) {
+      sub.nextMs = now + sub.periodMs;
+    }
+  }
+}
 
-    int ldrValue = ldrGetValue();
-    Serial.println("RES GET_LDR " + String(ldrValue));
+// Ticks até o próximo registro do histórico
+TickType_t historyWait() {
+  int32_t left = (int32_t)(historyNextMs - millis());
+  return left > 0 ? pdMS_TO_TICKS(left) : 0;
+}
 
-  } 
-  else if (cmd == "GET_TEMP") {
+// Grava um registro se já deu o período, com os valores dos retratos
+void historyUpdate() {
+  uint32_t now = millis();
+  if ((int32_t)(historyNextMs - now) > 0) {
+    return;
+  }
+  historyNextMs = now + HISTORY_PERIOD_MS;
 
-    float temp = dht.readTemperature();
+  HistoryRecord record = {};
+  DhtSnapshot snap;
+  record.ms = now;
+  if (dhtGetSnapshot(&snap)) {
+    record.temp = snap.tempCenti;
+    record.hum = snap.humMille;
+    record.flags |= HISTORY_DHT_OK;
+  }
+  record.ldr = ldrSnapshot.read().filtered;
+  record.led = ledValue;
+  history.push(record);
+}
 
-    if(isnan(temp)){
-        Serial.println("ERR SENSOR TEMP.");
-    }
-    else{
-        Serial.println("RES GET DHT " + String(temp, 1));
+void queueLine(const CommandLine &line, void *ctx) {
+  serialLines++;
+  if (line.overflow) {
+    serialOverflows++;
+  }
+  if (!commandQueue.push(line)) {
+    serialDrops++;
+    return;
+  }
+  xTaskNotifyGive(loopTaskHandle);
+}
+
+// Tratadores dos comandos. Cada um recebe o argumento já validado conforme a
+// tabela commandSpecs e envia a própria resposta.
+
+void cmdSetLed(long value) {
+  if (!actuatorSend(ACT_SET_LED, value)) {
+    respond(micros(), "RES SET_LED -1");
+    return;
+  }
+  ledValue = value;  // Atualiza a variável global
+  respond(micros(), "RES SET_LED 1");
+}
+
+void cmdGetLed(long) {
+  respond(micros(), "RES GET_LED %d", ledValue);
+}
+
+void cmdGetLdr(long) {
+  uint32_t sampled;
+  int ldrValue = ldrGetValue(&sampled);
+  respond(sampled, "RES GET_LDR %d", ldrValue);
+}
+
+void cmdSetLdrFilter(long value) {
+  if (!actuatorSend(ACT_LDR_FILTER, value)) {
+    respond(micros(), "RES SET_LDR_FILTER -1");
+    return;
+  }
+  respond(micros(), "RES SET_LDR_FILTER 1");
+}
+
+void cmdLdrCapture(long value) {
+  if (!actuatorSend(ACT_LDR_CAPTURE, value)) {
+    respond(micros(), "RES LDR_CAPTURE -1");
+    return;
+  }
+  ldrCaptureRequests++;
+  respond(micros(), "RES LDR_CAPTURE 1");
+}
+
+// "RES LDR_DUMP <taxa_hz> <n> <v1> ... <vn>": valores brutos do ADC (0..4095)
+// da última captura, numa linha só. Para ferramentas de análise; -1 se a
+// captura ainda não terminou.
+void cmdLdrDump(long) {
+  // A ioTask zera len e ajusta target antes de contar a captura como começada
+  bool started = ldrCaptureStarted == ldrCaptureRequests;
+  uint16_t len = ldrCaptureLen;
+
+  if (!started || len < ldrCaptureTarget) {
+    respond(micros(), "RES LDR_DUMP -1");
+    return;
+  }
+  LampSerial.printf("RES LDR_DUMP %lu %u", (unsigned long)ldrCaptureHz, len);
+  for (uint16_t i = 0; i < len; i++) {
+    LampSerial.printf(" %u", ldrCapture[i]);
+  }
+  respond(micros(), "");
+}
+
+// Temperatura e umidade vêm do retrato da dhtTask; o carimbo é o da leitura
+void cmdGetTemp(long) {
+  DhtSnapshot snap;
+
+  if (!dhtGetSnapshot(&snap)) {
+    respond(micros(), "ERR SENSOR TEMP.");
+  }
+  else if (fixedFormat) {
+    int32_t value = snap.tempCenti;
+    respondInts(snap.sampledMicros, "RES GET DHT", &value, 1);
+  }
+  else {
+    respond(snap.sampledMicros, "RES GET DHT %.1f", snap.temp);
+  }
+}
+
+void cmdGetHum(long) {
+  DhtSnapshot snap;
+
+  if (!dhtGetSnapshot(&snap)) {
+    respond(micros(), "ERR SENSOR HUM.");
+  }
+  else if (fixedFormat) {
+    int32_t value = snap.humMille;
+    respondInts(snap.sampledMicros, "RES GET DHT", &value, 1);
+  }
+  else {
+    respond(snap.sampledMicros, "RES GET DHT %.1f", snap.hum);
+  }
+}
+
+// "<prefixo> <temp> <hum> <indice> <ok>" no formato escolhido pelo SET_FORMAT
+void respondDht(const char *prefix, const DhtSnapshot &snap) {
+  if (fixedFormat) {
+    int32_t values[] = { snap.tempCenti, snap.humMille, snap.heatIndexCenti, snap.lastOk ? 1 : 0 };
+    respondInts(snap.sampledMicros, prefix, values, 4);
+  }
+  else {
+    respond(snap.sampledMicros, "%s %.1f %.1f %.1f %d", prefix,
+            snap.temp, snap.hum, snap.heatIndex, snap.lastOk ? 1 : 0);
+  }
+}
+
+// Temperatura, umidade e índice de calor da mesma leitura, numa só resposta:
+// "RES GET_DHT <temp> <hum> <indice> <ok>", com ok = 0 quando a leitura mais
+// recente falhou no checksum e os valores são da anterior
+void cmdGetDht(long) {
+  DhtSnapshot snap;
+
+  if (!dhtGetSnapshot(&snap)) {
+    respond(micros(), "ERR SENSOR DHT.");
+  }
+  else {
+    respondDht("RES GET_DHT", snap);
+  }
+}
+
+// "GET_ZONE <n>": como o GET_DHT, para a zona n (ver dhtZones)
+void cmdGetZone(long zone) {
+  DhtSnapshot snap;
+
+  if (!dhtGetZoneSnapshot(zone, &snap)) {
+    respond(micros(), "ERR SENSOR DHT.");
+  }
+  else {
+    respondDht("RES GET_ZONE", snap);
+  }
+}
+
+bool readLed(SubscriptionSample *sample) {
+  sample->values[0] = ledValue * 10;
+  sample->sampledMicros = micros();
+  return true;
+}
+
+bool readLdr(SubscriptionSample *sample) {
+  sample->values[0] = ldrGetValue(&sample->sampledMicros) * 10;
+  return true;
+}
+
+// Sem leitura boa recente, não envia nada
+bool readDht(SubscriptionSample *sample) {
+  if (!dhtGetSnapshot(&sample->dht)) {
+    return false;
+  }
+  sample->values[0] = lroundf(sample->dht.temp * 10);
+  sample->values[1] = lroundf(sample->dht.hum * 10);
+  sample->sampledMicros = sample->dht.sampledMicros;
+  return true;
+}
+
+void emitLed(const SubscriptionSample &sample) {
+  respond(sample.sampledMicros, "EVT LED %d", (int)(sample.values[0] / 10));
+}
+
+void emitLdr(const SubscriptionSample &sample) {
+  respond(sample.sampledMicros, "EVT LDR %d", (int)(sample.values[0] / 10));
+}
+
+// Mesmo formato do GET_DHT
+void emitDht(const SubscriptionSample &sample) {
+  respondDht("EVT DHT", sample.dht);
+}
+
+Subscription *findSubscription(const char *sensor) {
+  for (size_t i = 0; i < subscriptionCount; i++) {
+    if (strcasecmp(sensor, subscriptions[i].sensor) == 0) {
+      return &subscriptions[i];
     }
-    
   }
+  return NULL;
+}
 
-  else if (cmd == "GET_HUM") {
+// "SUBSCRIBE <LED|LDR|DHT> <periodo_ms>"; período 0 cancela só esse sensor.
+// A primeira leitura sai logo em seguida e é sempre enviada.
+void cmdSubscribe(const char *sensor, const long *values, uint8_t count) {
+  Subscription *sub = findSubscription(sensor);
+  long periodMs = values[0];
 
-    float hum = dht.readHumidity();
-    
-    if(isnan(hum)){
-        Serial.println("ERR SENSOR HUM.");
+  if (!sub || (periodMs != 0 && periodMs < SUBSCRIBE_MIN_MS)) {
+    respond(micros(), "RES SUBSCRIBE -1");
+    return;
+  }
+  sub->periodMs = periodMs;
+  sub->nextMs = millis();
+  sub->reported = false;
+  respond(micros(), "RES SUBSCRIBE 1");
+}
+
+// "SET_REPORT <LED|LDR|DHT> <abs> <pct> <min_ms> <max_ms>": relata só
+// mudanças de pelo menos abs (décimos da unidade do sensor) ou pct % do
+// último valor enviado, no máximo a cada min_ms e pelo menos a cada max_ms.
+// abs e pct zerados voltam a enviar toda leitura. Vale para o SUBSCRIBE
+// atual e os próximos do mesmo sensor.
+void cmdSetReport(const char *sensor, const long *values, uint8_t count) {
+  Subscription *sub = findSubscription(sensor);
+
+  if (!sub || count != 4 || values[1] < 0 || values[1] > 100 ||
+      values[2] < 0 || values[2] > SUBSCRIBE_MAX_MS || values[3] < 0 || values[3] > SUBSCRIBE_MAX_MS) {
+    respond(micros(), "RES SET_REPORT -1");
+    return;
+  }
+  sub->deadbandAbs = values[0];
+  sub->deadbandPct = values[1];
+  sub->minMs = values[2];
+  sub->maxMs = values[3];
+  sub->reported = false;
+  respond(micros(), "RES SET_REPORT 1");
+}
+
+void cmdUnsubscribe(long) {
+  for (size_t i = 0; i < subscriptionCount; i++) {
+    subscriptions[i].periodMs = 0;
+  }
+  respond(micros(), "RES UNSUBSCRIBE 1");
+}
+
+// Registros dos últimos maxAgeS segundos, em linhas "HIS <hex>" com até
+// HISTORY_LINE_RECORDS registros de 12 bytes cada (ver history.h), seguidas
+// de "RES GET_HISTORY <agora_ms> <n>". As linhas HIS não começam com RES, então
+// um driver que só espera a resposta as ignora.
+void cmdGetHistory(long maxAgeS) {
+  static char line[4 + HISTORY_LINE_RECORDS * 2 * sizeof(HistoryRecord) + 1];
+  uint32_t now = millis();
+  size_t first = history.firstSince(now - (uint32_t)maxAgeS * 1000);
+  size_t count = history.size() - first;
+
+  for (size_t i = first; i < history.size(); ) {
+    char *p = line;
+    memcpy(p, "HIS ", 4);
+    p += 4;
+    for (size_t n = 0; n < HISTORY_LINE_RECORDS && i < history.size(); n++, i++) {
+      historyToHex(history.at(i), p);
+      p += 2 * sizeof(HistoryRecord);
     }
-    else{
-        Serial.println("RES GET DHT " + String(hum, 1));
+    *p = '\0';
+    LampSerial.println(line);
+  }
+  respond(micros(), "RES GET_HISTORY %lu %u", (unsigned long)now, (unsigned)count);
+}
+
+void cmdSetStamp(long value) {
+  stampEnabled = value;
+  respond(micros(), "RES SET_STAMP 1");
+}
+
+void cmdSetFormat(long value) {
+  fixedFormat = value;
+  respond(micros(), "RES SET_FORMAT 1");
+}
+
+// Tabela de comandos: nome, argumento esperado e tratador. Um comando novo é
+// só uma entrada a mais aqui; o hash perfeito é recalculado na compilação.
+constexpr ProtocolCommandSpec commandSpecs[] = {
+  { "SET_LED",   PROTOCOL_ARG_INT,  0, 100, cmdSetLed },
+  { "GET_LED",   PROTOCOL_ARG_NONE, 0, 0,   cmdGetLed },
+  { "GET_LDR",   PROTOCOL_ARG_NONE, 0, 0,   cmdGetLdr },
+  { "SET_LDR_FILTER", PROTOCOL_ARG_INT, 0, LDRFILTER_EMA_MAX, cmdSetLdrFilter },
+  { "LDR_CAPTURE",    PROTOCOL_ARG_INT, 1, LDR_CAPTURE_MAX,   cmdLdrCapture },
+  { "LDR_DUMP",       PROTOCOL_ARG_NONE, 0, 0,                cmdLdrDump },
+  { "GET_TEMP",  PROTOCOL_ARG_NONE, 0, 0,   cmdGetTemp },
+  { "GET_HUM",   PROTOCOL_ARG_NONE, 0, 0,   cmdGetHum },
+  { "GET_DHT",   PROTOCOL_ARG_NONE, 0, 0,   cmdGetDht },
+  { "GET_ZONE",  PROTOCOL_ARG_INT,  0, DHT_ZONES - 1, cmdGetZone },
+  { "SET_STAMP", PROTOCOL_ARG_INT,  0, 1,   cmdSetStamp },
+  { "SET_FORMAT", PROTOCOL_ARG_INT, 0, 1,   cmdSetFormat },
+  { "GET_STATS", PROTOCOL_ARG_NONE, 0, 0,   cmdGetStats },
+  { "GET_HISTORY", PROTOCOL_ARG_INT, 0, HISTORY_MAX_AGE_S, cmdGetHistory },
+  { "SUBSCRIBE",   PROTOCOL_ARG_WORD_INT, 0, SUBSCRIBE_MAX_MS, NULL, cmdSubscribe },
+  { "SET_REPORT",  PROTOCOL_ARG_WORD_INT, 0, REPORT_MAX_ABS,   NULL, cmdSetReport },
+  { "UNSUBSCRIBE", PROTOCOL_ARG_NONE,     0, 0,                cmdUnsubscribe },
+};
+
+constexpr ProtocolTable<sizeof(commandSpecs) / sizeof(commandSpecs[0])> commandTable(commandSpecs);
+static_assert(commandTable.perfect(), "nome de comando repetido em commandSpecs");
+
+const size_t commandCount = sizeof(commandSpecs) / sizeof(commandSpecs[0]);
+PerfTimer commandTimers[commandCount];  // Tratador de cada comando, no loop
+
+// Uma linha "STA <nome> <n> <média> <máx> <h0>,...,<h7>" por contador
+void printTimer(const char *name, const PerfTimer &timer) {
+  char hist[PERFSTATS_BUCKETS * 11];
+  size_t len = 0;
+
+  for (size_t i = 0; i < PERFSTATS_BUCKETS; i++) {
+    len += snprintf(hist + len, sizeof(hist) - len, i ? ",%lu" : "%lu", (unsigned long)timer.bucket(i));
+  }
+  LampSerial.printf("STA %s %lu %lu %lu %s\n", name, (unsigned long)timer.count(),
+                    (unsigned long)timer.avg(), (unsigned long)timer.max(), hist);
+}
+
+// Estatísticas do firmware: as linhas STA com os tempos em ciclos de CPU
+// (ESP.getCpuFreqMHz() ciclos por us), só dos comandos que já rodaram, uma
+// linha DHT por zona e depois os contadores de erros e a memória livre
+void cmdGetStats(long) {
+  printTimer("loop", loopTimer);
+  printTimer("rx", rxTimer);
+  printTimer("parse", parseTimer);
+  printTimer("dht_read", dhtReadTimer);
+  printTimer("led", ledTimer);
+  for (size_t i = 0; i < commandCount; i++) {
+    if (commandTimers[i].count()) {
+      printTimer(commandSpecs[i].name, commandTimers[i]);
     }
   }
+  // Qualidade de cada DHT, contada por tentativa (ver DHT::stats). A cópia
+  // pode pegar a dhtTask no meio de uma atualização, o que não importa aqui.
+  dht_stats_t total = {};
+  for (size_t i = 0; i < DHT_ZONES; i++) {
+    dht_stats_t zone = dhtZones[i]->stats();
+    LampSerial.printf("DHT %u %lu %lu %lu %lu\n", (unsigned)i, (unsigned long)zone.successes,
+                      (unsigned long)zone.retries, (unsigned long)zone.timeouts,
+                      (unsigned long)zone.checksumErrors);
+    total.timeouts += zone.timeouts;
+    total.checksumErrors += zone.checksumErrors;
+  }
+  respond(micros(), "RES GET_STATS lines=%lu overflows=%lu drops=%lu dht_timeouts=%lu dht_checksum=%lu heap=%lu heap_min=%lu",
+          (unsigned long)serialLines, (unsigned long)serialOverflows, (unsigned long)serialDrops,
+          (unsigned long)total.timeouts, (unsigned long)total.checksumErrors,
+          (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMinFreeHeap());
+}
+
+void processCommand(const char *line, size_t len) {
+  // Separa comando e valor (ver protocol.cpp) e procura o comando na tabela
+  uint32_t start = ESP.getCycleCount();
+  ProtocolCommand parsed;
+  const ProtocolCommandSpec *spec = NULL;
+  if (protocolParse(line, len, &parsed)) {
+    spec = commandTable.find(parsed.name, strlen(parsed.name));
+  }
+  bool argOk = spec && protocolCheckArg(*spec, parsed);
+
+  parseTimer.add(ESP.getCycleCount() - start);
+
+  if (!spec) {
+    respond(micros(), "ERR Unknown command.");
+    return;
+  }
+  if (!argOk) {
+    respond(micros(), "RES %s -1", spec->name);
+    return;
+  }
 
+  CycleScope scope(commandTimers[spec - commandSpecs]);
+  if (spec->arg == PROTOCOL_ARG_WORD_INT) {
+    spec->wordHandler(parsed.word, parsed.values, parsed.valueCount);
+  }
   else {
-    Serial.println("ERR Unknown command.");
+    spec->handler(parsed.value);
+  }
+}
+
+// Envia uma linha de resposta formatada como no printf, com o carimbo de
+// tempo no fim se estiver ligado. Monta tudo num buffer fixo, sem String.
+void respond(uint32_t sampledMicros, const char *fmt, ...) {
+  static char buf[160];
+  va_list args;
+
+  va_start(args, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+  if (n < 0) {
+    return;
+  }
+  if (n >= (int)sizeof(buf)) {
+    n = sizeof(buf) - 1;
+  }
+
+  if (stampEnabled) {
+    snprintf(buf + n, sizeof(buf) - n, " @%lu,%lu",
+             (unsigned long)sampledMicros, (unsigned long)micros());
   }
+  LampSerial.println(buf);
 }
 
-// Função para atualizar o valor do LED
-void ledUpdate() {
-  // Valor deve convertar o valor recebido pelo comando SET_LED para 0 e 255
-  // Normalize o valor do LED antes de enviar para a porta correspondente
-  int pwmValue = map(ledValue, 0, 100, 0, 255);
-  analogWrite(ledPin, pwmValue);
+// Como respond(), para uma linha "<prefixo> <v1> ... <vn>" só com inteiros:
+// monta tudo com intfmt.h, sem vsnprintf
+void respondInts(uint32_t sampledMicros, const char *prefix, const int32_t *values, size_t count) {
+  static char buf[160];
+  size_t len = strlen(prefix);
+  char *p = buf + len;
+
+  // Cabe com folga: prefixos curtos, até 4 valores e o carimbo
+  memcpy(buf, prefix, len);
+  for (size_t i = 0; i < count; i++) {
+    *p++ = ' ';
+    p = intfmtSigned(p, values[i]);
+  }
+  if (stampEnabled) {
+    memcpy(p, " @", 2);
+    p = intfmtUnsigned(p + 2, sampledMicros);
+    *p++ = ',';
+    p = intfmtUnsigned(p, micros());
+  }
+  *p = '\0';
+  LampSerial.println(buf);
+}
+
+// Função para atualizar o valor do LED (na ioTask, depois do setup)
+void ledUpdate(int value) {
+  CycleScope scope(ledTimer);
+  // O valor recebido pelo comando SET_LED (0 a 100) é o brilho percebido; a
+  // tabela ledGamma o converte no duty cycle do LEDC
+  ledcWrite(ledPin, ledGamma[value]);
 }
 
 // Função para ler o valor do LDR
-int ldrGetValue() {
-  // Leia o sensor LDR e retorne o valor normalizado entre 0 e 100
+int ldrGetValue(uint32_t *sampledMicros) {
+  // Pegue o valor filtrado pela ioTask e retorne normalizado entre 0 e 100
   // faça testes para encontrar o valor maximo do ldr (exemplo: aponte a lanterna do celular para o sensor)
   // Atribua o valor para a variável ldrMax e utilize esse valor para a normalização
-  int rawValue = analogRead(ldrPin);
+  LdrSnapshot snap = ldrSnapshot.read();
+  int rawValue = snap.filtered;
+  *sampledMicros = snap.sampledMicros;
+
   int normalizedValue = (rawValue * 100) / ldrMax;
   if (normalizedValue > 100) normalizedValue = 100;
   if (normalizedValue < 0) normalizedValue = 0;
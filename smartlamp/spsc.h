@@ -0,0 +1,45 @@
+#ifndef SMARTLAMP_SPSC_H
+#define SMARTLAMP_SPSC_H
+
+// Fila sem trava para exatamente um produtor e um consumidor, que podem
+// estar em núcleos diferentes. Cada índice só é escrito por um dos lados,
+// então push() e pop() nunca esperam um pelo outro nem desligam interrupções.
+// Não depende do Arduino.h, então também compila no host.
+
+#include <atomic>
+#include <stddef.h>
+
+template <typename T, size_t N>
+class SpscQueue {
+public:
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "tamanho da fila deve ser potência de 2");
+
+  SpscQueue() : head_(0), tail_(0) {}
+
+  // Só o produtor. Retorna false com a fila cheia.
+  bool push(const T &item) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == N)
+      return false;
+    items_[head & (N - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Só o consumidor. Retorna false com a fila vazia.
+  bool pop(T *item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire))
+      return false;
+    *item = items_[tail & (N - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  T items_[N];
+  std::atomic<size_t> head_; // Próxima posição a escrever (produtor)
+  std::atomic<size_t> tail_; // Próxima posição a ler (consumidor)
+};
+
+#endif
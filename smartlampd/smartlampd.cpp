@@ -0,0 +1,659 @@
+// smartlampd: daemon que concentra o acesso a todas as lâmpadas.
+//
+// Os clientes pedem valores por um socket Unix (protocolo em smartlampd.h)
+// ou leem direto da memória compartilhada. O daemon:
+//   - responde do cache quando o valor é mais novo que a idade pedida;
+//   - junta pedidos iguais numa única leitura no driver (via libsmartlamp);
+//   - limita as escritas no LED a uma por intervalo por lâmpada, mandando
+//     só o valor mais recente;
+//   - com -H, grava a cada leitura periódica os últimos valores de cada
+//     lâmpada no histórico colunar (libsmartlamp/series.h).
+//
+// Uso: smartlampd [-s socket] [-a idade_ms] [-w intervalo_escrita_ms]
+//                 [-p periodo_leitura_ms] [-t threads] [-r raiz_sysfs]
+//                 [-H arquivo_historico]
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "series.h"
+#include "smartlamp.h"
+#include "smartlampd.h"
+
+namespace {
+
+struct Options {
+  std::string socket_path = SMARTLAMPD_SOCKET;
+  std::string sysfs_root = "/sys";
+  unsigned max_age_ms = 500;        // Idade máxima padrão de um valor do cache
+  unsigned write_interval_ms = 100; // Intervalo mínimo entre escritas no LED
+  unsigned poll_ms = 0;             // Leitura periódica de todos os sensores (0 = desligada)
+  unsigned workers = 4;
+  std::string history_path;         // Histórico colunar (vazio = desligado, exige -p)
+  unsigned history_flush_ms = 60000; // Grava os blocos incompletos do histórico
+};
+
+uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+const uint64_t kMs = 1000000ull;
+
+struct Conn {
+  int fd;
+  bool alive;
+};
+
+using ConnPtr = std::shared_ptr<Conn>;
+
+// Cliente esperando a resposta de um pedido
+struct Waiter {
+  ConnPtr conn;
+  uint32_t id;
+};
+
+struct LampState {
+  std::string name;
+  uint16_t series_id = 0;                            // Número no histórico (ver series.h)
+  uint64_t recorded_ns[SMARTLAMPD_NUM_SENSORS] = {}; // stamp_ns da última amostra gravada
+  bool reading[SMARTLAMPD_NUM_SENSORS] = {};
+  std::vector<Waiter> readers[SMARTLAMPD_NUM_SENSORS];
+
+  uint64_t last_write_ns = 0;
+  bool writing = false;             // Escrita em andamento no driver
+  std::vector<Waiter> writers;      // Esperando a escrita em andamento
+  bool write_pending = false;       // Escrita segurada pelo intervalo mínimo
+  int write_value = 0;
+  std::vector<Waiter> pending_writers;
+};
+
+// Resultado vindo de uma thread da libsmartlamp
+struct Completion {
+  size_t lamp;
+  int sensor; // -1 para escrita no LED
+  smartlamp::Result res;
+};
+
+class Daemon {
+public:
+  explicit Daemon(const Options &opt) : opt_(opt) {}
+  ~Daemon();
+
+  int init();
+  int run();
+
+private:
+  Options opt_;
+  std::vector<LampState> lamps_;
+  std::unique_ptr<smartlamp::Client> client_;
+  smartlamp::SeriesWriter history_;
+
+  int epfd_ = -1, listen_fd_ = -1, event_fd_ = -1, signal_fd_ = -1;
+  std::map<int, ConnPtr> conns_;
+
+  struct smartlampd_shm *shm_ = nullptr;
+  size_t shm_size_ = 0;
+
+  std::mutex done_mutex_;
+  std::vector<Completion> done_;
+  uint64_t next_poll_ns_ = 0;
+  uint64_t next_flush_ns_ = 0;
+
+  int init_shm();
+  int init_socket();
+  void watch(int fd);
+
+  void accept_clients();
+  void read_client(const ConnPtr &conn);
+  void close_client(const ConnPtr &conn);
+  void reply(const Waiter &w, int error, int32_t value, uint64_t stamp_ns);
+
+  void handle_get(const ConnPtr &conn, const struct smartlampd_req &req);
+  void handle_set(const ConnPtr &conn, const struct smartlampd_req &req);
+  void issue_read(size_t lamp, int sensor);
+  void issue_write(size_t lamp);
+  void complete(Completion *c);
+  void process_completions();
+  void run_timers();
+  int next_timeout();
+
+  void shm_store(size_t lamp, int sensor, const smartlamp::Result &res);
+  void record_history();
+};
+
+Daemon::~Daemon() {
+  client_.reset(); // Termina as threads antes de fechar o eventfd
+  for (auto &entry : conns_)
+    close(entry.first);
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+    unlink(opt_.socket_path.c_str());
+  }
+  if (event_fd_ >= 0)
+    close(event_fd_);
+  if (signal_fd_ >= 0)
+    close(signal_fd_);
+  if (epfd_ >= 0)
+    close(epfd_);
+  if (shm_) {
+    munmap(shm_, shm_size_);
+    shm_unlink(SMARTLAMPD_SHM_NAME);
+  }
+}
+
+int Daemon::init() {
+  std::vector<smartlamp::LampInfo> infos = smartlamp::discover(opt_.sysfs_root);
+  if (infos.empty())
+    fprintf(stderr, "smartlampd: nenhuma lâmpada encontrada em %s\n", opt_.sysfs_root.c_str());
+  if (infos.size() > UINT16_MAX)
+    infos.resize(UINT16_MAX);
+
+  lamps_.resize(infos.size());
+  for (size_t i = 0; i < infos.size(); i++)
+    lamps_[i].name = infos[i].name;
+
+  if (init_shm() < 0)
+    return -1;
+
+  epfd_ = epoll_create1(EPOLL_CLOEXEC);
+  event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epfd_ < 0 || event_fd_ < 0) {
+    perror("smartlampd: epoll/eventfd");
+    return -1;
+  }
+  watch(event_fd_);
+
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  sigprocmask(SIG_BLOCK, &mask, nullptr);
+  signal(SIGPIPE, SIG_IGN);
+  signal_fd_ = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (signal_fd_ < 0) {
+    perror("smartlampd: signalfd");
+    return -1;
+  }
+  watch(signal_fd_);
+
+  if (init_socket() < 0)
+    return -1;
+
+  if (!opt_.history_path.empty()) {
+    int err = history_.open(opt_.history_path);
+    if (err) {
+      fprintf(stderr, "smartlampd: %s: %s\n", opt_.history_path.c_str(), strerror(err));
+      return -1;
+    }
+    // A série de cada lâmpada segue o nome, não a ordem em que foi encontrada
+    for (auto &lamp : lamps_) {
+      err = history_.lamp_id(lamp.name, &lamp.series_id);
+      if (err) {
+        fprintf(stderr, "smartlampd: histórico de %s: %s\n", lamp.name.c_str(), strerror(err));
+        return -1;
+      }
+    }
+  }
+
+  client_.reset(new smartlamp::Client(infos, opt_.workers));
+  next_poll_ns_ = now_ns();
+  next_flush_ns_ = next_poll_ns_ + opt_.history_flush_ms * kMs;
+  return 0;
+}
+
+int Daemon::init_shm() {
+  int fd = shm_open(SMARTLAMPD_SHM_NAME, O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    perror("smartlampd: shm_open");
+    return -1;
+  }
+
+  shm_size_ = sizeof(struct smartlampd_shm) + lamps_.size() * sizeof(struct smartlampd_shm_lamp);
+  if (ftruncate(fd, shm_size_) < 0) {
+    perror("smartlampd: ftruncate");
+    close(fd);
+    return -1;
+  }
+
+  void *mem = mmap(nullptr, shm_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    perror("smartlampd: mmap");
+    return -1;
+  }
+
+  shm_ = static_cast<struct smartlampd_shm *>(mem);
+  memset(shm_, 0, shm_size_);
+  shm_->version = SMARTLAMPD_VERSION;
+  shm_->count = lamps_.size();
+  for (size_t i = 0; i < lamps_.size(); i++) {
+    snprintf(shm_->lamps[i].name, sizeof(shm_->lamps[i].name), "%s", lamps_[i].name.c_str());
+    for (int s = 0; s < SMARTLAMPD_NUM_SENSORS; s++)
+      shm_->lamps[i].error[s] = EAGAIN;
+  }
+  // O magic por último: leitores só confiam no resto depois de vê-lo
+  __atomic_store_n(&shm_->magic, SMARTLAMPD_MAGIC, __ATOMIC_RELEASE);
+  return 0;
+}
+
+int Daemon::init_socket() {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (opt_.socket_path.size() >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "smartlampd: caminho do socket muito longo\n");
+    return -1;
+  }
+  strcpy(addr.sun_path, opt_.socket_path.c_str());
+
+  listen_fd_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listen_fd_ < 0) {
+    perror("smartlampd: socket");
+    return -1;
+  }
+  unlink(addr.sun_path);
+  if (bind(listen_fd_, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+      listen(listen_fd_, 64) < 0) {
+    perror("smartlampd: bind/listen");
+    return -1;
+  }
+  watch(listen_fd_);
+  return 0;
+}
+
+void Daemon::watch(int fd) {
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = fd;
+  epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev);
+}
+
+void Daemon::accept_clients() {
+  for (;;) {
+    int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0)
+      return;
+    conns_[fd] = std::make_shared<Conn>(Conn{fd, true});
+    watch(fd);
+  }
+}
+
+void Daemon::close_client(const ConnPtr &conn) {
+  if (!conn->alive)
+    return;
+  conn->alive = false;
+  epoll_ctl(epfd_, EPOLL_CTL_DEL, conn->fd, nullptr);
+  close(conn->fd);
+  conns_.erase(conn->fd);
+}
+
+void Daemon::read_client(const ConnPtr &conn) {
+  struct smartlampd_req req;
+
+  while (conn->alive) {
+    // Com MSG_TRUNC, n é o tamanho real do datagrama mesmo que não caiba
+    // em req, então um pedido grande demais não passa por um válido
+    ssize_t n = recv(conn->fd, &req, sizeof(req), MSG_DONTWAIT | MSG_TRUNC);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR))
+      return;
+    if (n <= 0) {
+      close_client(conn);
+      return;
+    }
+    if ((size_t)n != sizeof(req)) {
+      reply({conn, 0}, EPROTO, 0, 0);
+      continue;
+    }
+
+    if (req.lamp >= lamps_.size()) {
+      reply({conn, req.id}, ENODEV, 0, 0);
+      continue;
+    }
+
+    switch (req.op) {
+    case SMARTLAMPD_OP_GET:
+      handle_get(conn, req);
+      break;
+    case SMARTLAMPD_OP_SET_LED:
+      handle_set(conn, req);
+      break;
+    default:
+      reply({conn, req.id}, EOPNOTSUPP, 0, 0);
+      break;
+    }
+  }
+}
+
+// Um cliente lento que enche o socket é desconectado em vez de segurar o daemon
+void Daemon::reply(const Waiter &w, int error, int32_t value, uint64_t stamp_ns) {
+  struct smartlampd_resp resp;
+
+  if (!w.conn->alive)
+    return;
+
+  resp.id = w.id;
+  resp.error = error;
+  resp.value = value;
+  resp.age_ms = stamp_ns ? (now_ns() - stamp_ns) / kMs : 0;
+  if (send(w.conn->fd, &resp, sizeof(resp), MSG_DONTWAIT | MSG_NOSIGNAL) != sizeof(resp))
+    close_client(w.conn);
+}
+
+void Daemon::handle_get(const ConnPtr &conn, const struct smartlampd_req &req) {
+  struct smartlampd_shm_lamp *shm = &shm_->lamps[req.lamp];
+  LampState &lamp = lamps_[req.lamp];
+  int s = req.sensor;
+
+  if (s >= SMARTLAMPD_NUM_SENSORS) {
+    reply({conn, req.id}, EINVAL, 0, 0);
+    return;
+  }
+
+  // Valor recente o bastante: responde do cache sem tocar no driver
+  uint64_t max_age = (req.value > 0 ? (uint64_t)req.value : opt_.max_age_ms) * kMs;
+  uint64_t stamp = shm->stamp_ns[s];
+  if (stamp && shm->error[s] == 0 && now_ns() - stamp <= max_age) {
+    reply({conn, req.id}, 0, shm->value[s], stamp);
+    return;
+  }
+
+  // Senão entra na próxima leitura, que é compartilhada por todos que pedirem
+  lamp.readers[s].push_back({conn, req.id});
+  if (!lamp.reading[s])
+    issue_read(req.lamp, s);
+}
+
+void Daemon::handle_set(const ConnPtr &conn, const struct smartlampd_req &req) {
+  LampState &lamp = lamps_[req.lamp];
+
+  if (req.value < 0 || req.value > 100) {
+    reply({conn, req.id}, EINVAL, 0, 0);
+    return;
+  }
+
+  lamp.write_pending = true;
+  lamp.write_value = req.value;
+  lamp.pending_writers.push_back({conn, req.id});
+
+  if (!lamp.writing && now_ns() - lamp.last_write_ns >= opt_.write_interval_ms * kMs)
+    issue_write(req.lamp);
+}
+
+void Daemon::issue_read(size_t idx, int sensor) {
+  lamps_[idx].reading[sensor] = true;
+  client_->read(lamps_[idx].name, static_cast<smartlamp::Sensor>(sensor),
+                [this, idx, sensor](const smartlamp::Result &res) {
+                  uint64_t one = 1;
+                  {
+                    std::lock_guard<std::mutex> lock(done_mutex_);
+                    done_.push_back({idx, sensor, res});
+                  }
+                  if (write(event_fd_, &one, sizeof(one)) < 0) {
+                    // O eventfd só falha se o contador estourar; o laço
+                    // principal já tem o que processar nesse caso
+                  }
+                });
+}
+
+void Daemon::issue_write(size_t idx) {
+  LampState &lamp = lamps_[idx];
+
+  lamp.writing = true;
+  lamp.write_pending = false;
+  lamp.last_write_ns = now_ns();
+  lamp.writers.swap(lamp.pending_writers);
+  lamp.pending_writers.clear();
+
+  client_->write_led(lamp.name, lamp.write_value, [this, idx](const smartlamp::Result &res) {
+    uint64_t one = 1;
+    {
+      std::lock_guard<std::mutex> lock(done_mutex_);
+      done_.push_back({idx, -1, res});
+    }
+    if (write(event_fd_, &one, sizeof(one)) < 0) {
+    }
+  });
+}
+
+void Daemon::shm_store(size_t idx, int sensor, const smartlamp::Result &res) {
+  struct smartlampd_shm_lamp *l = &shm_->lamps[idx];
+  uint32_t seq = l->seq;
+
+  __atomic_store_n(&l->seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  l->error[sensor] = res.error;
+  if (res.error == 0) {
+    l->value[sensor] = res.milli;
+    l->stamp_ns[sensor] = now_ns();
+  }
+  __atomic_store_n(&l->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+// Anexa ao histórico os valores de cada lâmpada cujos sensores foram todos
+// lidos de novo desde a última amostra gravada; uma lâmpada com leituras
+// falhando fica sem amostra em vez de repetir valores velhos. Chamado a cada
+// período de leitura, antes das novas leituras.
+void Daemon::record_history() {
+  struct timespec ts;
+
+  if (opt_.history_path.empty())
+    return;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  int64_t realtime_ms = (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+  uint64_t now = now_ns();
+
+  for (size_t i = 0; i < lamps_.size(); i++) {
+    const struct smartlampd_shm_lamp *l = &shm_->lamps[i];
+    LampState &lamp = lamps_[i];
+    bool fresh = true;
+    uint64_t newest = 0;
+    for (int s = 0; s < SMARTLAMPD_NUM_SENSORS; s++) {
+      fresh = fresh && l->stamp_ns[s] > lamp.recorded_ns[s];
+      newest = std::max(newest, l->stamp_ns[s]);
+    }
+    if (!fresh)
+      continue;
+    memcpy(lamp.recorded_ns, l->stamp_ns, sizeof(lamp.recorded_ns));
+
+    // A amostra leva o momento da leitura mais nova, em CLOCK_REALTIME
+    smartlamp::Sample sample;
+    sample.time_ms = realtime_ms - (int64_t)((now - newest) / kMs);
+    sample.ldr = l->value[SMARTLAMPD_LDR] / 1000;
+    sample.led = l->value[SMARTLAMPD_LED] / 1000;
+    sample.temp_centi = l->value[SMARTLAMPD_TEMP] / 10;
+    sample.hum_centi = l->value[SMARTLAMPD_HUM] / 10;
+
+    int err = history_.append(lamp.series_id, sample);
+    if (err)
+      fprintf(stderr, "smartlampd: histórico: %s\n", strerror(err));
+  }
+}
+
+void Daemon::complete(Completion *c) {
+  LampState &lamp = lamps_[c->lamp];
+
+  if (c->sensor < 0) {
+    std::vector<Waiter> writers;
+    writers.swap(lamp.writers);
+    lamp.writing = false;
+    if (c->res.error == 0)
+      shm_store(c->lamp, SMARTLAMPD_LED, c->res);
+    for (auto &w : writers)
+      reply(w, c->res.error, c->res.milli, 0);
+    return;
+  }
+
+  std::vector<Waiter> readers;
+  readers.swap(lamp.readers[c->sensor]);
+  lamp.reading[c->sensor] = false;
+  shm_store(c->lamp, c->sensor, c->res);
+  for (auto &w : readers)
+    reply(w, c->res.error, c->res.milli, shm_->lamps[c->lamp].stamp_ns[c->sensor]);
+}
+
+void Daemon::process_completions() {
+  uint64_t count;
+  std::vector<Completion> done;
+
+  if (read(event_fd_, &count, sizeof(count)) < 0 && errno != EAGAIN)
+    perror("smartlampd: eventfd");
+
+  {
+    std::lock_guard<std::mutex> lock(done_mutex_);
+    done.swap(done_);
+  }
+  for (auto &c : done)
+    complete(&c);
+}
+
+void Daemon::run_timers() {
+  uint64_t now = now_ns();
+
+  for (size_t i = 0; i < lamps_.size(); i++) {
+    LampState &lamp = lamps_[i];
+    if (lamp.write_pending && !lamp.writing &&
+        now - lamp.last_write_ns >= opt_.write_interval_ms * kMs)
+      issue_write(i);
+  }
+
+  if (opt_.poll_ms && now >= next_poll_ns_) {
+    next_poll_ns_ = now + opt_.poll_ms * kMs;
+    record_history();
+    if (!opt_.history_path.empty() && now >= next_flush_ns_) {
+      next_flush_ns_ = now + opt_.history_flush_ms * kMs;
+      int err = history_.flush();
+      if (err)
+        fprintf(stderr, "smartlampd: histórico: %s\n", strerror(err));
+    }
+    for (size_t i = 0; i < lamps_.size(); i++)
+      for (int s = 0; s < SMARTLAMPD_NUM_SENSORS; s++)
+        if (!lamps_[i].reading[s])
+          issue_read(i, s);
+  }
+}
+
+// Tempo até o próximo prazo (escrita segurada ou leitura periódica), em ms
+int Daemon::next_timeout() {
+  uint64_t now = now_ns();
+  uint64_t next = UINT64_MAX;
+
+  for (auto &lamp : lamps_)
+    if (lamp.write_pending && !lamp.writing)
+      next = std::min(next, lamp.last_write_ns + opt_.write_interval_ms * kMs);
+  if (opt_.poll_ms)
+    next = std::min(next, next_poll_ns_);
+
+  if (next == UINT64_MAX)
+    return -1;
+  if (next <= now)
+    return 0;
+  return (next - now + kMs - 1) / kMs;
+}
+
+int Daemon::run() {
+  struct epoll_event events[64];
+
+  for (;;) {
+    int n = epoll_wait(epfd_, events, 64, next_timeout());
+    if (n < 0 && errno != EINTR) {
+      perror("smartlampd: epoll_wait");
+      return 1;
+    }
+
+    for (int i = 0; i < n; i++) {
+      int fd = events[i].data.fd;
+      if (fd == signal_fd_)
+        return 0;
+      if (fd == listen_fd_)
+        accept_clients();
+      else if (fd == event_fd_)
+        process_completions();
+      else if (conns_.count(fd)) {
+        ConnPtr conn = conns_[fd]; // close_client() tira a conexão do mapa
+        read_client(conn);
+      }
+    }
+
+    run_timers();
+  }
+}
+
+void usage(const char *prog) {
+  fprintf(stderr,
+          "Uso: %s [-s socket] [-a idade_ms] [-w intervalo_escrita_ms]\n"
+          "          [-p periodo_leitura_ms] [-t threads] [-r raiz_sysfs]\n"
+          "          [-H arquivo_historico] [-F intervalo_gravacao_ms]\n",
+          prog);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  int c;
+
+  while ((c = getopt(argc, argv, "s:a:w:p:t:r:H:F:h")) != -1) {
+    switch (c) {
+    case 's':
+      opt.socket_path = optarg;
+      break;
+    case 'a':
+      opt.max_age_ms = strtoul(optarg, nullptr, 10);
+      break;
+    case 'w':
+      opt.write_interval_ms = strtoul(optarg, nullptr, 10);
+      break;
+    case 'p':
+      opt.poll_ms = strtoul(optarg, nullptr, 10);
+      break;
+    case 't':
+      opt.workers = strtoul(optarg, nullptr, 10);
+      break;
+    case 'r':
+      opt.sysfs_root = optarg;
+      break;
+    case 'H':
+      opt.history_path = optarg;
+      break;
+    case 'F':
+      opt.history_flush_ms = strtoul(optarg, nullptr, 10);
+      break;
+    default:
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  if (!opt.history_path.empty() && !opt.poll_ms) {
+    fprintf(stderr, "smartlampd: -H precisa de -p\n");
+    return 2;
+  }
+
+  Daemon daemon(opt);
+  if (daemon.init() < 0)
+    return 1;
+  return daemon.run();
+}
@@ -0,0 +1,82 @@
+#ifndef SMARTLAMPD_H
+#define SMARTLAMPD_H
+
+// Interface pública do smartlampd: o protocolo binário do socket Unix e o
+// layout da memória compartilhada com os últimos valores. Compila em C e C++.
+//
+// Socket (SOCK_SEQPACKET, uma mensagem por pedido/resposta):
+//   cliente -> smartlampd_req, daemon -> smartlampd_resp com o mesmo id.
+//   As lâmpadas são identificadas pelo índice em smartlampd_shm::lamps.
+//
+// Memória compartilhada (shm_open(SMARTLAMPD_SHM_NAME)): cada lâmpada tem um
+// seqlock; use smartlampd_shm_read() para copiar um retrato consistente.
+
+#include <stdint.h>
+
+#define SMARTLAMPD_SOCKET   "/run/smartlampd.sock"
+#define SMARTLAMPD_SHM_NAME "/smartlampd"
+#define SMARTLAMPD_MAGIC    0x4c4d5053u /* "SPML" */
+#define SMARTLAMPD_VERSION  1
+
+#define SMARTLAMPD_MAX_NAME 32
+
+/* Sensores, na mesma ordem de smartlamp::Sensor */
+enum smartlampd_sensor {
+    SMARTLAMPD_LED  = 0,
+    SMARTLAMPD_LDR  = 1,
+    SMARTLAMPD_TEMP = 2,
+    SMARTLAMPD_HUM  = 3,
+    SMARTLAMPD_NUM_SENSORS
+};
+
+enum smartlampd_op {
+    SMARTLAMPD_OP_GET     = 1, /* value = idade máxima aceita em ms (0 = padrão do daemon) */
+    SMARTLAMPD_OP_SET_LED = 2, /* value = brilho 0..100 */
+};
+
+struct smartlampd_req {
+    uint32_t id;     /* Devolvido na resposta */
+    uint8_t  op;     /* smartlampd_op */
+    uint8_t  sensor; /* smartlampd_sensor (OP_GET) */
+    uint16_t lamp;   /* Índice da lâmpada */
+    int32_t  value;
+};
+
+struct smartlampd_resp {
+    uint32_t id;
+    int32_t  error;  /* 0 ou errno */
+    int32_t  value;  /* Milésimos (23.5 °C -> 23500) */
+    uint32_t age_ms; /* Idade do valor quando a resposta foi enviada */
+};
+
+struct smartlampd_shm_lamp {
+    uint32_t seq;                                /* Ímpar durante uma atualização */
+    char     name[SMARTLAMPD_MAX_NAME];
+    int32_t  value[SMARTLAMPD_NUM_SENSORS];      /* Milésimos */
+    int32_t  error[SMARTLAMPD_NUM_SENSORS];      /* errno da última leitura */
+    uint64_t stamp_ns[SMARTLAMPD_NUM_SENSORS];   /* CLOCK_MONOTONIC; 0 = nunca lido */
+};
+
+struct smartlampd_shm {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+    struct smartlampd_shm_lamp lamps[];
+};
+
+/* Copia uma lâmpada da memória compartilhada sem travar o daemon */
+static inline void smartlampd_shm_read(const struct smartlampd_shm_lamp *src,
+                                       struct smartlampd_shm_lamp *dst)
+{
+    uint32_t seq;
+
+    do {
+        while ((seq = __atomic_load_n(&src->seq, __ATOMIC_ACQUIRE)) & 1)
+            ;
+        __builtin_memcpy(dst, src, sizeof(*dst));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&src->seq, __ATOMIC_RELAXED) != seq);
+}
+
+#endif